@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Benchmark of GridIndex, against pcl::KdTreeFLANN.
+/*! @file
+
+    Usage: grid_index_bench [points [queries [repetitions]]]
+
+    Both index the same synthetic cloud (noisy surfaces, at depth camera
+    ranges), then answer the same radius (5 cm) & 8-nearest queries, centered
+    near points of the cloud.  Builds are timed from an already-converted
+    cloud: a TangoPointCloud for GridIndex & a pcl::PointCloud for PCL.
+
+    The neighbors found by each are compared: kNN distances must agree, or
+    the benchmark fails.  Radius counts may differ only for points lying
+    within rounding error of the radius, so they're merely reported.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/grid_index.hpp"
+
+#include "pcl/point_cloud.h"
+#include "pcl/point_types.h"
+#include "pcl/kdtree/kdtree_flann.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+
+    typedef std::chrono::steady_clock clock_type;
+
+
+    const float radius = 0.05f;
+    const int k = 8;
+
+
+        // Fills points with noisy surfaces, as (x, y, z, confidence), in a depth camera-like frame.
+    void MakeCloud( int count, std::vector< float > &points )
+    {
+        std::mt19937 rng( 1 );
+        std::uniform_real_distribution< float > unit( 0.0f, 1.0f );
+        std::normal_distribution< float > noise( 0.0f, 0.005f );
+
+        points.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            const float u = unit( rng );
+            const float v = unit( rng );
+            if (unit( rng ) < 0.5f)     // Floor.
+            {
+                points.insert( points.end(), { -2.0f + 4.0f*u, 1.2f + noise( rng ), 0.5f + 4.0f*v, 1.0f } );
+            }
+            else                        // Wall, with a bump.
+            {
+                const float bump = 0.3f*std::exp( -20.0f*((u - 0.5f)*(u - 0.5f) + (v - 0.5f)*(v - 0.5f)) );
+                points.insert( points.end(), { -2.0f + 4.0f*u, -1.3f + 2.5f*v, 4.5f - bump + noise( rng ), 1.0f } );
+            }
+        }
+    }
+
+
+    double Seconds( clock_type::time_point start )
+    {
+        return std::chrono::duration< double >( clock_type::now() - start ).count();
+    }
+
+
+    void Report( const char *name, double build, double radius_search, double knn, int repetitions, int queries )
+    {
+        std::printf( "%-18s build %8.3f ms   radius %7.3f us/query   kNN %7.3f us/query\n",
+            name, 1e3*build/repetitions, 1e6*radius_search/(double( repetitions )*queries),
+            1e6*knn/(double( repetitions )*queries) );
+    }
+
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const int count = argc > 1 ? std::atoi( argv[1] ) : 45000;
+    const int queries = argc > 2 ? std::atoi( argv[2] ) : 1000;
+    const int repetitions = argc > 3 ? std::atoi( argv[3] ) : 10;
+
+    std::vector< float > points;
+    MakeCloud( count, points );
+
+    TangoPointCloud cloud = {};
+    cloud.num_points = uint32_t( count );
+    cloud.points = reinterpret_cast< float (*)[4] >( points.data() );
+
+    pcl::PointCloud< pcl::PointXYZ >::Ptr pcl_cloud( new pcl::PointCloud< pcl::PointXYZ > );
+    pcl_cloud->resize( count );
+    for (int i = 0; i < count; ++i)
+    {
+        pcl::PointXYZ &point = (*pcl_cloud)[i];
+        point.x = cloud.points[i][0];
+        point.y = cloud.points[i][1];
+        point.z = cloud.points[i][2];
+    }
+
+        // Queries are offset from evenly-spaced points of the cloud.
+    std::mt19937 rng( 2 );
+    std::uniform_real_distribution< float > offset( -0.02f, 0.02f );
+    std::vector< pcl::PointXYZ > centers( queries );
+    for (int q = 0; q < queries; ++q)
+    {
+        const float *p = cloud.points[ int( int64_t( q )*count/queries ) ];
+        centers[q].x = p[0] + offset( rng );
+        centers[q].y = p[1] + offset( rng );
+        centers[q].z = p[2] + offset( rng );
+    }
+
+    std::vector< int > indices;
+    std::vector< float > distances_sq;
+
+        // The results of the last repetition, for comparison.
+    std::vector< int > grid_counts( queries ), pcl_counts( queries );
+    std::vector< float > grid_knn( size_t( queries )*k ), pcl_knn( size_t( queries )*k );
+
+    {
+        boleo::GridIndex index( radius );
+        double build = 0.0, radius_search = 0.0, knn = 0.0;
+        for (int r = 0; r < repetitions; ++r)
+        {
+            clock_type::time_point start = clock_type::now();
+            index.build( &cloud );
+            build += Seconds( start );
+
+            start = clock_type::now();
+            for (int q = 0; q < queries; ++q)
+            {
+                const float center[3] = { centers[q].x, centers[q].y, centers[q].z };
+                grid_counts[q] = index.radiusSearch( center, radius, indices, distances_sq );
+            }
+            radius_search += Seconds( start );
+
+            start = clock_type::now();
+            for (int q = 0; q < queries; ++q)
+            {
+                const float center[3] = { centers[q].x, centers[q].y, centers[q].z };
+                const int found = index.nearestKSearch( center, k, indices, distances_sq );
+                for (int i = 0; i < found; ++i) grid_knn[ size_t( q )*k + i ] = distances_sq[i];
+            }
+            knn += Seconds( start );
+        }
+
+        Report( "GridIndex", build, radius_search, knn, repetitions, queries );
+    }
+
+    {
+        pcl::KdTreeFLANN< pcl::PointXYZ > tree;
+        double build = 0.0, radius_search = 0.0, knn = 0.0;
+        for (int r = 0; r < repetitions; ++r)
+        {
+            clock_type::time_point start = clock_type::now();
+            tree.setInputCloud( pcl_cloud );
+            build += Seconds( start );
+
+            start = clock_type::now();
+            for (int q = 0; q < queries; ++q)
+            {
+                pcl_counts[q] = tree.radiusSearch( centers[q], radius, indices, distances_sq );
+            }
+            radius_search += Seconds( start );
+
+            start = clock_type::now();
+            for (int q = 0; q < queries; ++q)
+            {
+                const int found = tree.nearestKSearch( centers[q], k, indices, distances_sq );
+                for (int i = 0; i < found; ++i) pcl_knn[ size_t( q )*k + i ] = distances_sq[i];
+            }
+            knn += Seconds( start );
+        }
+
+        Report( "pcl::KdTreeFLANN", build, radius_search, knn, repetitions, queries );
+    }
+
+        // Ties may be broken differently, so distances are compared, rather than indices.
+    int knn_mismatches = 0;
+    for (size_t i = 0; i < grid_knn.size(); ++i)
+    {
+        if (std::fabs( grid_knn[i] - pcl_knn[i] ) > 1e-5f*pcl_knn[i] + 1e-9f) ++knn_mismatches;
+    }
+
+    int radius_mismatches = 0;
+    long found = 0;
+    for (int q = 0; q < queries; ++q)
+    {
+        if (grid_counts[q] != pcl_counts[q]) ++radius_mismatches;
+        found += pcl_counts[q];
+    }
+
+    std::printf( "kNN distances: %d of %d differ.  Radius counts (mean %.1f): %d of %d differ.\n",
+        knn_mismatches, int( grid_knn.size() ), double( found )/queries, radius_mismatches, queries );
+
+    return knn_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Benchmark of ImagePyramid, against cv::buildPyramid().
+/*! @file
+
+    Usage: image_pyramid_bench [width [height [repetitions]]]
+
+    Both build 4 levels from the luma plane of the same synthetic NV21 image
+    (a smooth pattern, plus noise), whose rows are padded beyond its width.
+    OpenCV is limited to 1 thread, as ImagePyramid uses only 1.  A pyramid of
+    a region, a quarter of the image's width & height and of odd size, is
+    also timed.
+
+    Every level must match that of OpenCV byte for byte, or the benchmark
+    fails.  For the region, this applies to pixels more than 2 from its edges
+    (see ImagePyramid::build()), compared against the same pixels of the
+    whole image's pyramid.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/image_pyramid.hpp"
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+
+    typedef std::chrono::steady_clock clock_type;
+
+
+        // Fills the luma plane of an NV21 image, followed by its (gray) chroma plane.
+    void MakeImage( int width, int height, int stride, std::vector< uint8_t > &pixels )
+    {
+        std::mt19937 rng( 1 );
+        std::normal_distribution< float > noise( 0.0f, 12.0f );
+
+        pixels.assign( size_t( stride )*(height + (height + 1)/2), 128 );
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t *row = &pixels[ size_t( y )*stride ];
+            for (int x = 0; x < width; ++x)
+            {
+                const float value = 128.0f + 60.0f*std::sin( 0.031f*x )*std::cos( 0.047f*y ) + noise( rng );
+                row[x] = uint8_t( std::fmin( std::fmax( value, 0.0f ), 255.0f ) );
+            }
+        }
+    }
+
+
+        // Counts the pixels of level, lying more than margin from its edges, which differ from whole.
+    long CountMismatches( const boleo::PyramidLevel &level, const cv::Mat &whole, int margin )
+    {
+        long result = 0;
+        for (int v = margin; v < level.height - margin; ++v)
+        {
+            const uint8_t *row = level.data + size_t( v )*level.stride;
+            const uint8_t *expected = whole.ptr< uint8_t >( level.y + v ) + level.x;
+            for (int u = margin; u < level.width - margin; ++u)
+            {
+                if (row[u] != expected[u]) ++result;
+            }
+        }
+
+        return result;
+    }
+
+
+        // Checks each level against reference, reporting those which differ.
+    bool Compare( const char *name, const boleo::ImagePyramid &pyramid, const std::vector< cv::Mat > &reference,
+        int margin )
+    {
+            // A region may be too small for the last levels.
+        const int levels = int( reference.size() );
+        if (pyramid.levels() > levels || (margin == 0 && pyramid.levels() != levels))
+        {
+            std::printf( "%s: %d levels, but OpenCV built %d\n", name, pyramid.levels(), levels );
+            return false;
+        }
+
+        bool same = true;
+        for (int i = 0; i < pyramid.levels(); ++i)
+        {
+            const boleo::PyramidLevel &level = pyramid.level( i );
+            const cv::Mat &whole = reference[i];
+            if (level.x + level.width > whole.cols || level.y + level.height > whole.rows
+                || (margin == 0 && (level.width != whole.cols || level.height != whole.rows)))
+            {
+                std::printf( "%s: level %d is %dx%d at (%d, %d), but OpenCV's is %dx%d\n",
+                    name, i, level.width, level.height, level.x, level.y, whole.cols, whole.rows );
+                same = false;
+                continue;
+            }
+
+            const long mismatches = CountMismatches( level, whole, margin );
+            if (mismatches != 0)
+            {
+                std::printf( "%s: %ld pixels of level %d differ\n", name, mismatches, i );
+                same = false;
+            }
+        }
+
+        return same;
+    }
+
+
+    double Seconds( clock_type::time_point start )
+    {
+        return std::chrono::duration< double >( clock_type::now() - start ).count();
+    }
+
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const int width = argc > 1 ? std::atoi( argv[1] ) : 1280;
+    const int height = argc > 2 ? std::atoi( argv[2] ) : 720;
+    const int repetitions = argc > 3 ? std::atoi( argv[3] ) : 100;
+
+    const int stride = ((width + 63) & ~63) + 64;
+    std::vector< uint8_t > pixels;
+    MakeImage( width, height, stride, pixels );
+
+    TangoImageBuffer image = {};
+    image.width = uint32_t( width );
+    image.height = uint32_t( height );
+    image.stride = uint32_t( stride );
+    image.format = TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP;
+    image.data = pixels.data();
+
+    const boleo::PyramidRoi roi = { width/4 + 3, height/4 + 5, width/4 + 1, height/4 + 3 };
+
+    boleo::PyramidParams params;
+    params.levels = 4;
+    boleo::ImagePyramid pyramid( params ), region( params );
+
+    clock_type::time_point start = clock_type::now();
+    for (int r = 0; r < repetitions; ++r) pyramid.build( &image );
+    const double whole_seconds = Seconds( start );
+
+    start = clock_type::now();
+    for (int r = 0; r < repetitions; ++r) region.build( &image, roi );
+    const double region_seconds = Seconds( start );
+
+    cv::setNumThreads( 1 );
+    const cv::Mat luma( height, width, CV_8UC1, pixels.data(), size_t( stride ) );
+    std::vector< cv::Mat > reference;
+
+    start = clock_type::now();
+    for (int r = 0; r < repetitions; ++r) cv::buildPyramid( luma, reference, pyramid.levels() - 1 );
+    const double opencv_seconds = Seconds( start );
+
+    std::printf( "ImagePyramid       %8.3f ms/build\n", 1e3*whole_seconds/repetitions );
+    std::printf( "cv::buildPyramid   %8.3f ms/build\n", 1e3*opencv_seconds/repetitions );
+    std::printf( "ImagePyramid (roi) %8.3f ms/build, of %dx%d at (%d, %d)\n",
+        1e3*region_seconds/repetitions, region.level( 0 ).width, region.level( 0 ).height,
+        region.level( 0 ).x, region.level( 0 ).y );
+
+    const bool whole_same = Compare( "whole", pyramid, reference, 0 );
+    const bool region_same = Compare( "roi", region, reference, 2 );
+    const bool same = whole_same && region_same;
+    std::printf( "%d levels: %s\n", pyramid.levels(), same ? "match" : "DIFFER" );
+    return same ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Benchmark of OccupancyMap insertion throughput.
+/*! @file
+
+    Usage: occupancy_map_bench [points [clouds [threads]]]
+
+    Synthetic clouds resemble those of a depth camera, turning on the spot
+    in a room: points lie within a 60 degree cone, at ranges of 0.5 - 5 m, so
+    some exceed OccupancyParams::max_range.  The map is built with 1 thread &
+    with the given number (default: one per core), and each reports
+    OccupancyStats::pointsPerSecond().
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/occupancy_map.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+        // Fills points with a cloud, as (x, y, z, confidence), in the depth camera frame.
+    void MakeCloud( std::mt19937 &rng, int count, std::vector< float > &points )
+    {
+        std::uniform_real_distribution< float > angle( -0.5f, 0.5f );
+        std::uniform_real_distribution< float > range( 0.5f, 5.0f );
+
+        points.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            const float x = angle( rng );
+            const float y = angle( rng );
+            const float r = range( rng );
+            const float scale = r/std::sqrt( 1.0f + x*x + y*y );
+            points.insert( points.end(), { x*scale, y*scale, scale, 1.0f } );
+        }
+    }
+
+
+        // A depth camera pose, turned by yaw about the vertical axis.
+    boleo::Transform MakePose( float yaw )
+    {
+        boleo::Transform result = boleo::IdentityTransform();
+        result.rotation[0][0] = std::cos( yaw );
+        result.rotation[0][2] = std::sin( yaw );
+        result.rotation[2][0] = -std::sin( yaw );
+        result.rotation[2][2] = std::cos( yaw );
+        result.translation[1] = 1.2f;
+        return result;
+    }
+
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const int count = argc > 1 ? std::atoi( argv[1] ) : 10000;
+    const int clouds = argc > 2 ? std::atoi( argv[2] ) : 100;
+    const int threads = argc > 3 ? std::atoi( argv[3] ) : int( std::thread::hardware_concurrency() );
+
+        // Generated up front, so only insertion is timed.
+    std::mt19937 rng( 1 );
+    std::vector< std::vector< float > > points( clouds );
+    for (std::vector< float > &cloud: points) MakeCloud( rng, count, cloud );
+
+    for (int t: { 1, threads > 0 ? threads : 1 })
+    {
+        boleo::OccupancyParams params;
+        params.threads = t;
+        boleo::OccupancyMap map( params );
+
+        for (int c = 0; c < clouds; ++c)
+        {
+            TangoPointCloud cloud = {};
+            cloud.num_points = uint32_t( count );
+            cloud.points = reinterpret_cast< float (*)[4] >( points[c].data() );
+            map.insert( &cloud, MakePose( 0.05f*c ) );
+        }
+
+        const boleo::OccupancyStats &stats = map.stats();
+        std::printf( "%2d thread%s %8.3f ms/cloud %12.0f points/s %10.0f voxel updates/cloud %9d nodes\n",
+            t, t == 1 ? " " : "s", 1e3*stats.seconds/stats.clouds, stats.pointsPerSecond(),
+            double( stats.voxel_updates )/stats.clouds, map.nodeCount() );
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Benchmark of a fused pipeline, against the equivalent hand-written loop.
+/*! @file
+
+    Usage: pipeline_bench [points [repetitions]]
+
+    Both transform each point of the same synthetic cloud, keep those with
+    z < 3 m, and convert them to an xyz point type, appending the results to
+    a vector with reserved capacity.  The outputs are compared, and the mean
+    time per cloud is reported for each.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/pipeline.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+
+    typedef std::chrono::steady_clock clock_type;
+
+
+        // Stands in for pcl::PointXYZ.
+    struct PointXYZ
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+
+        // Appends each output to a vector.
+    struct AppendSink
+    {
+        std::vector< PointXYZ > &points;
+
+        void operator()( const PointXYZ &point ) const
+        {
+            points.push_back( point );
+        }
+    };
+
+
+        // A pose rotated 30 degrees about x & raised 1.2 m along z.
+    boleo::Transform MakePose()
+    {
+        const float c = std::cos( 0.5236f );
+        const float s = std::sin( 0.5236f );
+        boleo::Transform result = boleo::IdentityTransform();
+        result.rotation[1][1] = c;
+        result.rotation[1][2] = -s;
+        result.rotation[2][1] = s;
+        result.rotation[2][2] = c;
+        result.translation[2] = 1.2f;
+        return result;
+    }
+
+
+        // Reports the mean time per cloud & per point.
+    void Report( const char *name, double seconds, int repetitions, int count )
+    {
+        std::printf( "%-12s %8.3f ms/cloud %8.2f ns/point\n",
+            name, 1e3*seconds/repetitions, 1e9*seconds/(double( repetitions )*count) );
+    }
+
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const int count = argc > 1 ? std::atoi( argv[1] ) : 45000;
+    const int repetitions = argc > 2 ? std::atoi( argv[2] ) : 1000;
+
+    std::mt19937 rng( 1 );
+    std::uniform_real_distribution< float > lateral( -2.0f, 2.0f );
+    std::uniform_real_distribution< float > depth( 0.3f, 5.0f );
+
+    std::vector< float > points;
+    for (int i = 0; i < count; ++i)
+    {
+        points.insert( points.end(), { lateral( rng ), lateral( rng ), depth( rng ), 1.0f } );
+    }
+
+    TangoPointCloud cloud = {};
+    cloud.num_points = uint32_t( count );
+    cloud.points = reinterpret_cast< float (*)[4] >( points.data() );
+
+    const boleo::Transform pose = MakePose();
+
+    std::vector< PointXYZ > fused;
+    fused.reserve( count );
+    {
+        const auto pipeline = boleo::TransformBy( pose )
+            | boleo::KeepIf( []( const boleo::PipelinePoint &p ) { return p.z < 3.0f; } )
+            | boleo::ConvertTo< PointXYZ >();
+        AppendSink sink = { fused };
+
+        const clock_type::time_point start = clock_type::now();
+        for (int r = 0; r < repetitions; ++r)
+        {
+            fused.clear();
+            boleo::PointCloud_forEach( &cloud, pipeline, sink );
+        }
+        const double seconds = std::chrono::duration< double >( clock_type::now() - start ).count();
+        Report( "pipeline", seconds, repetitions, count );
+    }
+
+    std::vector< PointXYZ > manual;
+    manual.reserve( count );
+    {
+        const clock_type::time_point start = clock_type::now();
+        for (int r = 0; r < repetitions; ++r)
+        {
+            manual.clear();
+            for (uint32_t i = 0; i != cloud.num_points; ++i)
+            {
+                float p[3];
+                boleo::Transform_apply( pose, cloud.points[i], p );
+                if (!(p[2] < 3.0f)) continue;
+
+                const PointXYZ point = { p[0], p[1], p[2] };
+                manual.push_back( point );
+            }
+        }
+        const double seconds = std::chrono::duration< double >( clock_type::now() - start ).count();
+        Report( "hand-written", seconds, repetitions, count );
+    }
+
+    const bool same = fused.size() == manual.size()
+        && std::memcmp( fused.data(), manual.data(), fused.size()*sizeof (PointXYZ) ) == 0;
+
+    std::printf( "%d of %d points kept; outputs %s\n", int( fused.size() ), count, same ? "match" : "DIFFER" );
+    return same ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Benchmark of PlaneExtractor, against pcl::SACSegmentation.
+/*! @file
+
+    Usage: plane_extractor_bench [points [repetitions [threads]]]
+
+    Both extract up to 3 planes, one after another, from the same synthetic
+    room (a floor, 2 walls & a table top, amid clutter), with the same
+    RANSAC settings.  PCL's loop removes each plane's inliers with
+    pcl::ExtractIndices, before searching for the next.
+
+    PlaneExtractor is run with 1 thread & with the given number (default: one
+    per core).  SACSegmentation is single-threaded.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/plane_extractor.hpp"
+
+#include "pcl/ModelCoefficients.h"
+#include "pcl/PointIndices.h"
+#include "pcl/point_cloud.h"
+#include "pcl/point_types.h"
+#include "pcl/filters/extract_indices.h"
+#include "pcl/sample_consensus/method_types.h"
+#include "pcl/sample_consensus/model_types.h"
+#include "pcl/segmentation/sac_segmentation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+    typedef std::chrono::steady_clock clock_type;
+
+
+        // Fills points with a noisy room, as (x, y, z, confidence), in a depth camera-like frame.
+    void MakeRoom( int count, std::vector< float > &points )
+    {
+        std::mt19937 rng( 1 );
+        std::uniform_real_distribution< float > unit( 0.0f, 1.0f );
+        std::normal_distribution< float > noise( 0.0f, 0.005f );
+
+        points.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            const float u = unit( rng );
+            const float v = unit( rng );
+            const float kind = unit( rng );
+            float p[3];
+            if (kind < 0.40f)           // Floor.
+            {
+                p[0] = -2.0f + 4.0f*u;  p[1] = 1.2f + noise( rng );  p[2] = 0.5f + 4.0f*v;
+            }
+            else if (kind < 0.65f)      // Back wall.
+            {
+                p[0] = -2.0f + 4.0f*u;  p[1] = -1.3f + 2.5f*v;  p[2] = 4.5f + noise( rng );
+            }
+            else if (kind < 0.80f)      // Side wall.
+            {
+                p[0] = 2.0f + noise( rng );  p[1] = -1.3f + 2.5f*u;  p[2] = 0.5f + 4.0f*v;
+            }
+            else if (kind < 0.90f)      // Table top.
+            {
+                p[0] = -1.0f + 1.2f*u;  p[1] = 0.45f + noise( rng );  p[2] = 2.0f + 0.8f*v;
+            }
+            else                        // Clutter.
+            {
+                p[0] = -2.0f + 4.0f*u;  p[1] = -1.3f + 2.5f*v;  p[2] = 0.5f + 4.0f*unit( rng );
+            }
+
+            points.insert( points.end(), { p[0], p[1], p[2], 1.0f } );
+        }
+    }
+
+
+        // Reports the mean time per cloud & the inliers of each plane.
+    void Report( const char *name, double seconds, int repetitions, const std::vector< int > &inliers )
+    {
+        std::printf( "%-28s %8.2f ms/cloud   planes:", name, 1e3*seconds/repetitions );
+        for (int count: inliers) std::printf( " %d", count );
+        std::printf( "\n" );
+    }
+
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const int count = argc > 1 ? std::atoi( argv[1] ) : 45000;
+    const int repetitions = argc > 2 ? std::atoi( argv[2] ) : 20;
+    const int threads = argc > 3 ? std::atoi( argv[3] ) : std::max( int( std::thread::hardware_concurrency() ), 1 );
+
+    std::vector< float > points;
+    MakeRoom( count, points );
+
+    TangoPointCloud cloud = {};
+    cloud.num_points = uint32_t( count );
+    cloud.points = reinterpret_cast< float (*)[4] >( points.data() );
+
+    boleo::PlaneParams params;
+    params.max_planes = 3;
+
+    for (int t: { 1, threads })
+    {
+        params.threads = t;
+        boleo::PlaneExtractor extractor( params );
+
+        std::vector< int > inliers;
+        const clock_type::time_point start = clock_type::now();
+        for (int r = 0; r < repetitions; ++r) extractor.extract( &cloud );
+        const double seconds = std::chrono::duration< double >( clock_type::now() - start ).count();
+
+        for (int i = 0; i < extractor.size(); ++i) inliers.push_back( extractor.plane( i ).inliers );
+
+        char name[64];
+        std::snprintf( name, sizeof name, "PlaneExtractor (%d thread%s)", t, t == 1 ? "" : "s" );
+        Report( name, seconds, repetitions, inliers );
+    }
+
+        // PCL, including the conversion from the TangoPointCloud.
+    {
+        pcl::SACSegmentation< pcl::PointXYZ > segmentation;
+        segmentation.setOptimizeCoefficients( true );
+        segmentation.setModelType( pcl::SACMODEL_PLANE );
+        segmentation.setMethodType( pcl::SAC_RANSAC );
+        segmentation.setDistanceThreshold( params.distance );
+        segmentation.setMaxIterations( params.max_hypotheses );
+        segmentation.setProbability( params.probability );
+
+        pcl::ExtractIndices< pcl::PointXYZ > extract;
+        extract.setNegative( true );
+
+        std::vector< int > inliers;
+        const clock_type::time_point start = clock_type::now();
+        for (int r = 0; r < repetitions; ++r)
+        {
+            pcl::PointCloud< pcl::PointXYZ >::Ptr remaining( new pcl::PointCloud< pcl::PointXYZ > );
+            remaining->resize( cloud.num_points );
+            for (uint32_t i = 0; i != cloud.num_points; ++i)
+            {
+                pcl::PointXYZ &point = (*remaining)[i];
+                point.x = cloud.points[i][0];
+                point.y = cloud.points[i][1];
+                point.z = cloud.points[i][2];
+            }
+
+            inliers.clear();
+            while (int( inliers.size() ) < params.max_planes && int( remaining->size() ) >= params.min_inliers)
+            {
+                pcl::PointIndices::Ptr indices( new pcl::PointIndices );
+                pcl::ModelCoefficients coefficients;
+                segmentation.setInputCloud( remaining );
+                segmentation.segment( *indices, coefficients );
+                if (int( indices->indices.size() ) < params.min_inliers) break;
+
+                inliers.push_back( int( indices->indices.size() ) );
+
+                pcl::PointCloud< pcl::PointXYZ >::Ptr rest( new pcl::PointCloud< pcl::PointXYZ > );
+                extract.setInputCloud( remaining );
+                extract.setIndices( indices );
+                extract.filter( *rest );
+                remaining = rest;
+            }
+        }
+        const double seconds = std::chrono::duration< double >( clock_type::now() - start ).count();
+
+        Report( "pcl::SACSegmentation", seconds, repetitions, inliers );
+    }
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Benchmark of IcpRegistration, on a known rigid motion.
+/*! @file
+
+    Usage: registration_bench [repetitions [threads]]
+
+    A synthetic room (walls, floor, ceiling & 2 boxes) is raycast from 2
+    camera poses, 1 degree & 5 cm apart (so that few points move further
+    than IcpParams::max_distance), giving a cloud per pixel of a 320x180
+    depth camera, with 2 mm of noise.  The first is aligned to the second,
+    starting from the identity, with 1 thread & with the given number
+    (default: one per core).  Each reports the time per iteration (including
+    pyramid construction), plus the final residual & the error of the
+    recovered motion.  The benchmark fails
+    if the error exceeds 5 mm or 0.25 degrees.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/registration.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+    const int width = 320;
+    const int height = 180;
+
+
+        // An axis-aligned box.
+    struct Box
+    {
+        float min[3];
+        float max[3];
+    };
+
+
+        // The room, in the target camera's frame (y down, z forward).
+    const Box room = { { -2.0f, -1.2f, -1.0f }, { 2.0f, 1.3f, 4.5f } };
+
+    const Box obstacles[] = {
+        { { -1.2f, 0.3f, 2.0f }, { -0.4f, 1.3f, 2.8f } },
+        { { 0.5f, -0.5f, 3.0f }, { 1.1f, 1.3f, 3.6f } }
+    };
+
+
+        // Distance along direction, from origin (inside the room), to the nearest surface.
+    float Raycast( const float *origin, const float *direction )
+    {
+        float nearest = INFINITY;
+        for (int a = 0; a < 3; ++a)
+        {
+            if (direction[a] != 0.0f)
+            {
+                const float wall = direction[a] > 0.0f ? room.max[a] : room.min[a];
+                nearest = std::min( nearest, (wall - origin[a])/direction[a] );
+            }
+        }
+
+        for (const Box &box: obstacles)
+        {
+            float enter = 0.0f, leave = INFINITY;
+            for (int a = 0; a < 3; ++a)
+            {
+                const float t0 = (box.min[a] - origin[a])/direction[a];
+                const float t1 = (box.max[a] - origin[a])/direction[a];
+                enter = std::max( enter, std::min( t0, t1 ) );
+                leave = std::min( leave, std::max( t0, t1 ) );
+            }
+
+            if (enter < leave) nearest = std::min( nearest, enter );
+        }
+
+        return nearest;
+    }
+
+
+        // Fills points with the surfaces seen by a camera at pose (w.r.t. the room), in its own frame.
+    void MakeCloud(
+        const TangoCameraIntrinsics &intrinsics, const boleo::Transform &pose, std::mt19937 &rng,
+        std::vector< float > &points )
+    {
+        std::normal_distribution< float > noise( 0.0f, 0.002f );
+
+        points.clear();
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const float ray[3] = {
+                    float( (x - intrinsics.cx)/intrinsics.fx ), float( (y - intrinsics.cy)/intrinsics.fy ), 1.0f };
+
+                float direction[3];
+                for (int r = 0; r < 3; ++r)
+                {
+                    direction[r] = pose.rotation[r][0]*ray[0] + pose.rotation[r][1]*ray[1]
+                        + pose.rotation[r][2]*ray[2];
+                }
+
+                const float z = Raycast( pose.translation, direction ) + noise( rng );
+                points.insert( points.end(), { ray[0]*z, ray[1]*z, z, 1.0f } );
+            }
+        }
+    }
+
+
+        // The source camera's pose: turned about (1, 2, 0) & moved.
+    boleo::Transform MakeMotion()
+    {
+        const double angle = M_PI/180.0;
+        const double s = std::sin( 0.5*angle )/std::sqrt( 5.0 );
+
+        TangoPoseData pose = {};
+        pose.orientation[0] = s;
+        pose.orientation[1] = 2.0*s;
+        pose.orientation[3] = std::cos( 0.5*angle );
+        pose.translation[0] = 0.03;
+        pose.translation[1] = -0.02;
+        pose.translation[2] = 0.035;
+        return boleo::Pose_toTransform( &pose );
+    }
+
+
+        // Rotation (in degrees) & translation (in mm) of the difference between a & b.
+    void PoseError( const boleo::Transform &a, const boleo::Transform &b, double &degrees, double &mm )
+    {
+        const boleo::Transform error = boleo::Transform_compose( boleo::Transform_inverse( a ), b );
+        const double trace = error.rotation[0][0] + error.rotation[1][1] + error.rotation[2][2];
+        degrees = std::acos( std::max( -1.0, std::min( 1.0, 0.5*(trace - 1.0) ) ) )*180.0/M_PI;
+
+        double sum = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const double d = a.translation[i] - b.translation[i];
+            sum += d*d;
+        }
+
+        mm = 1e3*std::sqrt( sum );
+    }
+
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const int repetitions = argc > 1 ? std::atoi( argv[1] ) : 20;
+    const int threads = argc > 2 ? std::atoi( argv[2] ) : int( std::thread::hardware_concurrency() );
+
+    TangoCameraIntrinsics intrinsics = {};
+    intrinsics.width = width;
+    intrinsics.height = height;
+    intrinsics.fx = intrinsics.fy = 250.0;
+    intrinsics.cx = 0.5*(width - 1);
+    intrinsics.cy = 0.5*(height - 1);
+
+        // The target camera is at the room's origin, so the motion maps source points into its frame.
+    const boleo::Transform motion = MakeMotion();
+
+    std::mt19937 rng( 1 );
+    std::vector< float > source_points, target_points;
+    MakeCloud( intrinsics, motion, rng, source_points );
+    MakeCloud( intrinsics, boleo::IdentityTransform(), rng, target_points );
+
+    TangoPointCloud source = {}, target = {};
+    source.num_points = uint32_t( source_points.size()/4 );
+    source.points = reinterpret_cast< float (*)[4] >( source_points.data() );
+    target.num_points = uint32_t( target_points.size()/4 );
+    target.points = reinterpret_cast< float (*)[4] >( target_points.data() );
+
+    bool accurate = true;
+    for (int t: { 1, threads > 0 ? threads : 1 })
+    {
+        boleo::IcpParams params;
+        params.threads = t;
+        boleo::IcpRegistration icp( &intrinsics, params );
+
+        double seconds = 0.0;
+        int iterations = 0;
+        boleo::IcpResult result;
+        for (int r = 0; r < repetitions; ++r)
+        {
+            result = icp.align( &source, &target, boleo::IdentityTransform() );
+            seconds += result.seconds;
+            iterations += result.iterations;
+        }
+
+        double degrees, mm;
+        PoseError( result.transform, motion, degrees, mm );
+        accurate = accurate && degrees < 0.25 && mm < 5.0;
+
+        std::printf( "%2d thread%s %7.3f ms/align %7.3f ms/iteration %3d iterations %s  "
+            "rms %.2f mm over %d  error %.3f deg %.2f mm\n",
+            t, t == 1 ? " " : "s", 1e3*seconds/repetitions, 1e3*seconds/iterations, result.iterations,
+            result.converged ? "converged" : "unconverged", 1e3*result.rms_error, result.correspondences,
+            degrees, mm );
+    }
+
+    return accurate ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Benchmark of TaskScheduler throughput & latency, under mixed load.
+/*! @file
+
+    Usage: task_scheduler_bench [threads [seconds [big]]]
+
+    A producer thread submits work resembling that of a Tango app:
+
+    * Frame tasks of 2 ms, at 30 Hz, via a TaskStream, each with a deadline
+      of one frame period.
+    * Bursts of 16 short tasks of 20 us, every millisecond.  Each spawns 2
+      follow-up tasks on its own worker, which must be stolen to spread out.
+
+    Latency is measured from submission to the start of each task.  If the
+    third argument is "big", workers are pinned to FastestCpus().
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/task_scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+    typedef boleo::TaskScheduler::clock_type clock_type;
+
+
+    const std::chrono::microseconds frame_period( 33333 );
+    const std::chrono::microseconds frame_cost( 2000 );
+    const std::chrono::microseconds burst_period( 1000 );
+    const std::chrono::microseconds short_cost( 20 );
+    const int burst_size = 16;
+    const int follow_ups = 2;
+
+
+        // Occupies the calling thread for duration.
+    void Spin( clock_type::duration duration )
+    {
+        const clock_type::time_point end = clock_type::now() + duration;
+        while (clock_type::now() < end)
+        {
+        }
+    }
+
+
+        // Latencies of one class of task, in microseconds.  Samples beyond the capacity are discarded.
+    class LatencyLog
+    {
+    public:
+        explicit LatencyLog( size_t capacity )
+        : samples_( capacity ), count_( 0 )
+        {
+        }
+
+        void record( clock_type::time_point submitted )
+        {
+            const size_t i = count_.fetch_add( 1, std::memory_order_relaxed );
+            if (i < samples_.size())
+            {
+                samples_[i] = std::chrono::duration< float, std::micro >( clock_type::now() - submitted ).count();
+            }
+        }
+
+        void print( const char *name )
+        {
+            const size_t n = std::min( count_.load(), samples_.size() );
+            if (n == 0)
+            {
+                std::printf( "%-8s no samples\n", name );
+                return;
+            }
+
+            std::sort( samples_.begin(), samples_.begin() + n );
+            auto percentile = [&]( double p ) { return samples_[ std::min( size_t( p*n ), n - 1 ) ]; };
+            std::printf( "%-8s %8zu started   latency (us): p50 %8.1f   p99 %8.1f   p99.9 %8.1f   max %8.1f\n",
+                name, n, percentile( 0.5 ), percentile( 0.99 ), percentile( 0.999 ), samples_[ n - 1 ] );
+        }
+
+    private:
+        std::vector< float > samples_;
+        std::atomic< size_t > count_;
+    };
+
+}
+
+
+int main( int argc, char *argv[] )
+{
+    boleo::SchedulerParams params;
+    params.threads = argc > 1 ? std::atoi( argv[1] ) : 0;
+    const double seconds = argc > 2 ? std::atof( argv[2] ) : 5.0;
+    if (argc > 3 && std::strcmp( argv[3], "big" ) == 0) params.cpus = boleo::FastestCpus();
+
+    const size_t bursts = size_t( seconds/std::chrono::duration< double >( burst_period ).count() ) + 1;
+    LatencyLog frame_latency( size_t( seconds*30.0 ) + 1 );
+    LatencyLog short_latency( bursts*burst_size*(1 + follow_ups) );
+
+    boleo::TaskScheduler scheduler( params );
+    boleo::TaskStream frames;
+
+    std::function< void ( clock_type::time_point, int ) > short_task =
+        [&]( clock_type::time_point submitted, int depth )
+        {
+            short_latency.record( submitted );
+            Spin( short_cost );
+            if (depth > 0) return;
+
+            for (int i = 0; i < follow_ups; ++i)
+            {
+                const clock_type::time_point now = clock_type::now();
+                scheduler.submit( [&short_task, now] { short_task( now, 1 ); } );
+            }
+        };
+
+    const clock_type::time_point start = clock_type::now();
+    const clock_type::time_point end = start
+        + std::chrono::duration_cast< clock_type::duration >( std::chrono::duration< double >( seconds ) );
+
+    clock_type::time_point next_frame = start;
+    clock_type::time_point next_burst = start;
+    while (next_burst < end)
+    {
+        if (next_frame <= next_burst)
+        {
+            const clock_type::time_point now = clock_type::now();
+            scheduler.submit( frames,
+                [&frame_latency, now] { frame_latency.record( now ); Spin( frame_cost ); },
+                now + frame_period );
+
+            next_frame += frame_period;
+        }
+        else
+        {
+            const clock_type::time_point now = clock_type::now();
+            for (int i = 0; i < burst_size; ++i)
+            {
+                scheduler.submit( [&short_task, now] { short_task( now, 0 ); } );
+            }
+
+            next_burst += burst_period;
+        }
+
+        std::this_thread::sleep_until( std::min( next_frame, next_burst ) );
+    }
+
+    scheduler.wait();
+    const double elapsed = std::chrono::duration< double >( clock_type::now() - start ).count();
+
+    const boleo::SchedulerStats stats = scheduler.stats();
+    std::printf( "%d workers, %.2f s\n", scheduler.threadCount(), elapsed );
+    std::printf( "executed %lld of %lld tasks: %.0f tasks/s\n",
+        (long long) stats.executed, (long long) stats.submitted, double( stats.executed )/elapsed );
+    std::printf( "stolen %lld, superseded %lld, expired %lld, overran %lld (deadline misses %lld)\n",
+        (long long) stats.stolen, (long long) stats.superseded, (long long) stats.expired,
+        (long long) stats.overran, (long long) stats.deadlineMisses() );
+
+    frame_latency.print( "frames" );
+    short_latency.print( "short" );
+    return 0;
+}
@@ -0,0 +1,183 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides direct conversion of TangoPointCloud into packed binary layouts.
+/*! @file
+
+    For serialization & transport, points are usually wanted as a flat byte
+    buffer with a fixed stride, rather than as an array of structs.  These
+    functions write such buffers directly from TangoPointCloud::points, in a
+    single pass.
+
+    The common layouts are available as compile-time types, which reduce to
+    a memcpy (BlobXyzi) or a SIMD channel drop (BlobXyz).  Other layouts can
+    be described at runtime, via BlobLayout.
+
+    @code
+
+        std::vector< uint8_t > buffer( 16*cloud->num_points );
+        PointCloud_toBlob< BlobXyz >( cloud, buffer.data() );
+
+            // Or, with a layout specified at runtime:
+        BlobLayout layout;
+        layout.point_step = 8;
+        layout.fields.push_back( { channel_x, 3, 0, blob_int16 } );
+        layout.fields.push_back( { channel_confidence, 1, 6, blob_uint16 } );
+        PointCloud_toBlob( cloud, layout, buffer.data() );
+
+    @endcode
+
+    Conversion to pcl::PCLPointCloud2 is provided by pcl.hpp.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_BLOB_HPP_
+#define BOLEO_BLOB_HPP_
+
+
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Storage type of a blob field.
+    /*!
+        Values match pcl::PCLPointField::PointFieldTypes.  Integer types
+        receive the channel value, rounded & saturated.
+    */
+enum BlobDatatype
+{
+    blob_int8 = 1,
+    blob_uint8 = 2,
+    blob_int16 = 3,
+    blob_uint16 = 4,
+    blob_int32 = 5,
+    blob_uint32 = 6,
+    blob_float32 = 7,
+    blob_float64 = 8
+};
+
+
+    //! Channels of a TangoPointCloud point, in storage order.
+enum BlobChannel
+{
+    channel_x = 0,
+    channel_y = 1,
+    channel_z = 2,
+    channel_confidence = 3
+};
+
+
+    //! Describes where a run of consecutive channels is written, per point.
+struct BlobField
+{
+    BlobChannel channel;    //!< First channel of the run.
+    int count;              //!< Number of consecutive channels.
+    int32_t offset;         //!< Byte offset within each point.
+    BlobDatatype datatype;  //!< Storage type of each channel.
+};
+
+
+    //! A runtime description of a packed point layout.
+struct BlobLayout
+{
+    std::vector< BlobField > fields;    //!< Fields to write.
+    int32_t point_step;                 //!< Bytes between successive points.
+};
+
+
+    //! Compile-time layout: packed float32 x, y, z (12 bytes).
+struct BlobXyz
+{
+    static constexpr int32_t point_step = 12;
+
+        //! The equivalent runtime layout.
+    static BlobLayout layout();
+};
+
+
+    //! Compile-time layout: packed float32 x, y, z, confidence (16 bytes).
+    /*!
+        This is identical to the layout of TangoPointCloud::points.
+    */
+struct BlobXyzi
+{
+    static constexpr int32_t point_step = 16;
+
+        //! The equivalent runtime layout.
+    static BlobLayout layout();
+};
+
+
+    //! Returns the size, in bytes, of a BlobDatatype.
+int BlobDatatype_size( BlobDatatype datatype );
+
+
+    //! Checks that layout can be written by PointCloud_toBlob().
+    /*!
+        @throws std::invalid_argument if point_step isn't positive, or a field
+        lies outside point_step, has an unknown datatype, or refers to
+        channels beyond channel_confidence.
+    */
+void BlobLayout_validate( const BlobLayout &layout );
+
+
+    //! Writes cloud into out, per a compile-time layout.
+    /*!
+        out must hold num_points * layout_type::point_step bytes, and needn't
+        be aligned.  Only BlobXyz and BlobXyzi are supported.
+    */
+template<
+    typename layout_type    //!< BlobXyz or BlobXyzi.
+>
+void PointCloud_toBlob(
+    const TangoPointCloud *cloud,   //!< Input cloud.
+    uint8_t *out                    //!< Output buffer.
+);
+
+
+    //! Writes cloud into out, per a runtime layout.
+    /*!
+        out must hold num_points * layout.point_step bytes.  Bytes not covered
+        by any field are left unmodified.
+
+        @throws std::invalid_argument if the layout is invalid.  See
+        BlobLayout_validate().
+    */
+void PointCloud_toBlob(
+    const TangoPointCloud *cloud,   //!< Input cloud.
+    const BlobLayout &layout,       //!< Description of the output.
+    uint8_t *out                    //!< Output buffer.
+);
+
+
+
+////////////////////////////////////////////////////////////
+// Specializations
+////////////////////////////////////////////////////////////
+
+template<> void PointCloud_toBlob< BlobXyz >( const TangoPointCloud *, uint8_t * );
+template<> void PointCloud_toBlob< BlobXyzi >( const TangoPointCloud *, uint8_t * );
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_BLOB_HPP_
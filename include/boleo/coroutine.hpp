@@ -0,0 +1,448 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides C++20 coroutine access to the frames of a TangoFrameHub.
+/*! @file
+
+    FrameStreams returns awaitables for the next point cloud, pose or image.
+    A suspended coroutine is resumed via an Executor, once a frame arrives,
+    its timeout expires, or its Cancellation is triggered.
+
+    @code
+
+        TangoFrameHub hub;          // Fed by the Tango callbacks.
+        RunLoopExecutor executor;
+        FrameStreams streams( hub, executor );
+
+        Detached Process( FrameStreams &streams, Cancellation &stop )
+        {
+            AwaitOptions options;
+            options.timeout = std::chrono::milliseconds( 500 );
+            options.cancellation = &stop;
+
+            for (;;)
+            {
+                StreamResult< CloudFrame > cloud =
+                    co_await streams.nextPointCloud( options );
+
+                if (cloud.status == stream_timeout) continue;
+                if (!cloud) break;
+
+                TangoPointCloud view = cloud.frame->view();
+                Consume( &view );
+            }
+        }
+
+        Process( streams, stop );
+        executor.run();
+
+    @endcode
+
+    An await makes no heap allocation of its own, once the stream's
+    subscription has been created (on its first use).  The awaiter lives in
+    the coroutine frame and links itself into the subscription, timer &
+    cancellation.
+
+    Each stream (cloud, per-camera images, per-frame pair poses) supports a
+    single outstanding await.  All awaits must complete before the
+    FrameStreams, Executor or Cancellation they use is destroyed.
+
+    This header requires C++20.  Build with the EnableCoroutines option.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_COROUTINE_HPP_
+#define BOLEO_COROUTINE_HPP_
+
+
+#if !defined( __cpp_impl_coroutine )
+#   error "boleo/coroutine.hpp requires C++20 (see EnableCoroutines)."
+#endif
+
+
+#include "boleo/frame_hub.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Outcome of awaiting a frame.
+enum StreamStatus
+{
+    stream_ok,          //!< A frame was received.
+    stream_timeout,     //!< AwaitOptions::timeout expired first.
+    stream_cancelled,   //!< AwaitOptions::cancellation was triggered first.
+    stream_closed       //!< The subscription was closed.
+};
+
+
+    //! Result of co_await on a FrameAwaiter.
+template<
+    typename Frame      //!< Frame type.
+>
+struct StreamResult
+{
+    FrameRef< const Frame > frame;  //!< Valid only if status is stream_ok.
+    StreamStatus status;            //!< Why the await completed.
+
+    explicit operator bool() const
+    {
+        return status == stream_ok;
+    }
+};
+
+
+    //! Resumes coroutines whose awaits have completed.
+class Executor
+{
+public:
+    virtual ~Executor();
+
+        //! Arranges for handle to be resumed.  May be called from any thread.
+    virtual void post( std::coroutine_handle<> handle ) = 0;
+};
+
+
+    //! Resumes coroutines immediately, on the thread which completes them.
+    /*!
+        That's usually a Tango callback thread or the timer thread, so resumed
+        coroutines should quickly co_await again or hand off their work.
+    */
+class InlineExecutor: public Executor
+{
+public:
+    void post( std::coroutine_handle<> handle ) override;
+};
+
+
+    //! Queues coroutines, to be resumed by a thread calling run() or poll().
+    /*!
+        post() may be called from any thread, but only one thread at a time
+        may call run() or poll().
+    */
+class RunLoopExecutor: public Executor
+{
+public:
+    RunLoopExecutor();
+
+    void post( std::coroutine_handle<> handle ) override;
+
+        //! Resumes coroutines as they're posted, until stop() is called.
+    void run();
+
+        //! Resumes those coroutines already posted.  Doesn't block.
+        /*!
+            @returns the number resumed.
+        */
+    int poll();
+
+        //! Causes run() to return, once it's finished its current batch.
+    void stop();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector< std::coroutine_handle<> > pending_;
+    std::vector< std::coroutine_handle<> > running_;   // Swapped with pending_.
+    bool stopped_;
+};
+
+
+namespace detail
+{
+    class AwaitCore;
+    class TimerQueue;
+}
+
+
+    //! Triggers completion of all the awaits which refer to it.
+    /*!
+        Once cancelled, subsequent awaits complete immediately, with
+        stream_cancelled.
+    */
+class Cancellation
+{
+public:
+    Cancellation();
+    Cancellation( const Cancellation & ) = delete;
+    Cancellation &operator=( const Cancellation & ) = delete;
+
+        //! Completes pending awaits, with stream_cancelled.  Thread-safe.
+    void cancel();
+
+    bool cancelled() const;
+
+private:
+    friend class detail::AwaitCore;
+
+    bool add( detail::AwaitCore *await );   // false, if already cancelled.
+    void remove( detail::AwaitCore *await );
+
+    std::mutex mutex_;
+    std::atomic< bool > cancelled_;
+    detail::AwaitCore *head_;
+};
+
+
+    //! Per-await settings.
+struct AwaitOptions
+{
+        //! Zero waits indefinitely.
+    std::chrono::steady_clock::duration timeout =
+        std::chrono::steady_clock::duration::zero();
+
+        //! Optional.  Must outlive the await.
+    Cancellation *cancellation = nullptr;
+};
+
+
+namespace detail
+{
+
+        // Thread which completes timed-out awaits.  Started on first use.
+    class TimerQueue
+    {
+    public:
+        TimerQueue();
+        TimerQueue( const TimerQueue & ) = delete;
+        TimerQueue &operator=( const TimerQueue & ) = delete;
+        ~TimerQueue();
+
+        void add( AwaitCore *await );
+        void remove( AwaitCore *await );
+
+    private:
+        void run();
+
+        std::mutex mutex_;
+        std::condition_variable changed_;
+        AwaitCore *head_;   // Sorted by deadline.
+        bool stopping_;
+        std::thread thread_;
+    };
+
+
+        // Non-template part of FrameAwaiter.
+        /*
+            An await can be completed by its subscription, its timer or its
+            cancellation.  Each of those claims it via a CAS on state_, while
+            holding its own lock.  The winner unlinks it from the others &
+            then posts the coroutine.  If the claim occurred before
+            await_suspend() finished registering, the winner instead marks it
+            finished, and await_suspend() returns false.
+        */
+    class AwaitCore: public SubscriptionWaiter
+    {
+    public:
+        AwaitCore(
+            Executor &executor,
+            TimerQueue &timers,
+            const AwaitOptions &options );
+
+        AwaitCore( const AwaitCore & ) = delete;
+        AwaitCore &operator=( const AwaitCore & ) = delete;
+
+        bool claim( bool closed ) override;
+        void wake() override;
+
+    protected:
+        ~AwaitCore() {}
+
+            // Implements await_suspend().
+        bool suspend( std::coroutine_handle<> handle );
+
+        virtual bool subscribe() = 0;   // false, if a frame is ready.
+        virtual void unsubscribe() = 0;
+
+        StreamStatus status_;
+
+    private:
+        friend class boleo::Cancellation;
+        friend class TimerQueue;
+
+        enum State { registering, waiting, claimed, finished };
+
+        bool tryClaim( StreamStatus status );
+        void finish();
+        void waitFinished() const;
+
+        std::atomic< int > state_;
+        int prior_;     // State from which it was claimed.
+        std::coroutine_handle<> handle_;
+        Executor *executor_;
+
+        TimerQueue *timers_;
+        std::chrono::steady_clock::time_point deadline_;
+        bool timed_;
+        AwaitCore *timer_prev_;
+        AwaitCore *timer_next_;
+        bool timer_linked_;
+
+        Cancellation *cancellation_;
+        AwaitCore *cancel_prev_;
+        AwaitCore *cancel_next_;
+        bool cancel_linked_;
+    };
+
+}
+
+
+    //! Awaitable for the next frame of a Subscription.  See FrameStreams.
+template<
+    typename Frame      //!< Frame type.
+>
+class FrameAwaiter: public detail::AwaitCore
+{
+public:
+    typedef Subscription< Frame > subscription_type;
+
+    FrameAwaiter(
+        std::shared_ptr< subscription_type > subscription,
+        Executor &executor,
+        detail::TimerQueue &timers,
+        const AwaitOptions &options
+    )
+    : detail::AwaitCore( executor, timers, options ),
+      subscription_( std::move( subscription ) ),
+      cancellation_( options.cancellation )
+    {
+    }
+
+    bool await_ready()
+    {
+        if (cancellation_ && cancellation_->cancelled())
+        {
+            status_ = stream_cancelled;
+            return true;
+        }
+
+        return subscription_->tryPop( frame_ );
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        return suspend( handle );
+    }
+
+    StreamResult< Frame > await_resume()
+    {
+        if (!frame_ && status_ == stream_ok && !subscription_->tryPop( frame_ ))
+        {
+            status_ = stream_closed;
+        }
+
+        return StreamResult< Frame >{ std::move( frame_ ), status_ };
+    }
+
+private:
+    bool subscribe() override
+    {
+        return subscription_->asyncWait( this );
+    }
+
+    void unsubscribe() override
+    {
+        subscription_->cancelWait( this );
+    }
+
+    std::shared_ptr< subscription_type > subscription_;
+    Cancellation *cancellation_;
+    FrameRef< const Frame > frame_;
+};
+
+
+    //! Creates awaitables for the frames of a TangoFrameHub.
+    /*!
+        Each stream's subscription is created on its first await, using the
+        QueuePolicy supplied at construction.  Frames published before then
+        aren't seen.
+    */
+class FrameStreams
+{
+public:
+    FrameStreams(
+        TangoFrameHub &hub,     //!< Source of frames.
+        Executor &executor,     //!< Resumes completed awaits.
+        const QueuePolicy &policy = LatestOnly()    //!< Per stream.
+    );
+
+        //! Closes all subscriptions.
+    ~FrameStreams();
+
+    FrameAwaiter< CloudFrame > nextPointCloud(
+        const AwaitOptions &options = AwaitOptions() );
+
+    FrameAwaiter< PoseFrame > nextPose(
+        const TangoCoordinateFramePair &frame_pair,
+        const AwaitOptions &options = AwaitOptions() );
+
+    FrameAwaiter< ImageFrame > nextImage(
+        TangoCameraId camera,
+        const AwaitOptions &options = AwaitOptions() );
+
+private:
+    typedef std::pair< int, int > pose_key; // Base & target frames.
+
+    TangoFrameHub &hub_;
+    Executor &executor_;
+    QueuePolicy policy_;
+
+    std::mutex mutex_;  // Guards lazy creation of subscriptions.
+    std::shared_ptr< Subscription< CloudFrame > > clouds_;
+    std::map< TangoCameraId, std::shared_ptr< Subscription< ImageFrame > > >
+        images_;
+    std::map< pose_key, std::shared_ptr< Subscription< PoseFrame > > > poses_;
+
+    detail::TimerQueue timers_; // Last, so its thread stops first.
+};
+
+
+    //! Return type for fire & forget coroutines.
+    /*!
+        The coroutine starts immediately and its frame is freed when it
+        finishes.  An escaping exception calls std::terminate().
+    */
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() { return Detached(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_COROUTINE_HPP_
@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides an organized depth image, projected from a TangoPointCloud.
+/*! @file
+
+    TangoPointCloud is unorganized, but its points are all observed from
+    the depth camera.  Projecting them through the camera's intrinsics
+    recovers a depth image, in which image neighbors are (usually) spatial
+    neighbors.  Algorithms such as projective data association & normal
+    estimation exploit this.
+
+    @code
+
+        TangoCameraIntrinsics intrinsics;
+        TangoService_getCameraIntrinsics( TANGO_CAMERA_DEPTH, &intrinsics );
+
+        DepthImage depth;
+        PointCloud_toDepthImage( cloud, &intrinsics, depth );
+
+        DepthImage half;
+        DepthImage_halve( depth, half );
+
+    @endcode
+
+    Lens distortion is ignored, which suits the depth camera.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_DEPTH_IMAGE_HPP_
+#define BOLEO_DEPTH_IMAGE_HPP_
+
+
+#include "boleo/detail/aligned.hpp"
+#include "boleo/detail/features.hpp"
+
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Pinhole projection parameters, in pixels.
+struct PinholeCamera
+{
+    float fx;   //!< Focal length, in x.
+    float fy;   //!< Focal length, in y.
+    float cx;   //!< Principal point, in x.
+    float cy;   //!< Principal point, in y.
+};
+
+
+    //! A single-channel image of depth (z), in meters.  0 means no data.
+class DepthImage
+{
+public:
+        //! Storage type of the pixels.
+    typedef std::vector<
+        float,
+        detail::AlignedAllocator< float, BOLEO_SIMD_ALIGNMENT > > storage_type;
+
+    DepthImage();
+
+        //! Sets the size & camera, and clears all pixels to 0.
+        /*!
+            Existing capacity is retained.
+        */
+    void reset( int width, int height, const PinholeCamera &camera );
+
+    int width() const;
+    int height() const;
+
+        //! The camera which the image is modeled on.
+    const PinholeCamera &camera() const;
+
+        //! Pointers to width() pixels of row y.
+    float *row( int y );
+    const float *row( int y ) const;
+
+        //! Computes the 3D point at pixel (x, y).
+        /*!
+            @returns false if the pixel has no depth.
+        */
+    bool unproject(
+        int x,              //!< Column.
+        int y,              //!< Row.
+        float *point        //!< Receives (x, y, z).
+    ) const;
+
+private:
+    int width_;
+    int height_;
+    PinholeCamera camera_;
+    storage_type depth_;
+};
+
+
+    //! The PinholeCamera of intrinsics, for an image scaled down by divisor.
+PinholeCamera PinholeCamera_fromIntrinsics(
+    const TangoCameraIntrinsics *intrinsics,    //!< Camera to model.
+    int divisor = 1                             //!< Integer scale-down factor.
+);
+
+
+    //! Projects cloud into a depth image of intrinsics / divisor pixels.
+    /*!
+        Where several points fall in the same pixel, the nearest is kept.
+        Points outside the image, or with z <= 0, are ignored.
+    */
+void PointCloud_toDepthImage(
+    const TangoPointCloud *cloud,               //!< Input cloud.
+    const TangoCameraIntrinsics *intrinsics,    //!< Of the depth camera.
+    DepthImage &result,                         //!< Output image.
+    int divisor = 1                             //!< Integer scale-down factor.
+);
+
+
+    //! Downsamples image by 2, in each dimension.
+    /*!
+        Each output pixel is the mean of those valid pixels in its 2x2 block
+        lying within 5% of the nearest, so that edges aren't smeared across
+        depth discontinuities.
+    */
+void DepthImage_halve(
+    const DepthImage &image,    //!< Input image.
+    DepthImage &result          //!< Output image.
+);
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_DEPTH_IMAGE_HPP_
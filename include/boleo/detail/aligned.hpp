@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Allocator for over-aligned buffers.
+/*! @file
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_ALIGNED_HPP_
+#define BOLEO_ALIGNED_HPP_
+
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+
+namespace boleo
+{
+
+namespace detail
+{
+
+
+    // An STL allocator, returning storage aligned to Alignment bytes.
+    /*
+        C++11 operator new only guarantees alignment suitable for fundamental
+        types, so this over-allocates and stashes the original pointer just
+        ahead of the aligned block.
+    */
+template<
+    typename T,
+    std::size_t Alignment
+>
+class AlignedAllocator
+{
+public:
+    static_assert( (Alignment & (Alignment - 1)) == 0, "Must be a power of 2" );
+    static_assert( Alignment >= sizeof (void *), "Must fit a pointer" );
+
+    typedef T value_type;
+
+    template< typename U > struct rebind
+    {
+        typedef AlignedAllocator< U, Alignment > other;
+    };
+
+    AlignedAllocator() = default;
+
+    template< typename U >
+    AlignedAllocator( const AlignedAllocator< U, Alignment > & )
+    {
+    }
+
+    T *allocate( std::size_t n )
+    {
+        const std::size_t bytes = n*sizeof (T) + Alignment + sizeof (void *);
+        void *raw = ::operator new( bytes );
+        const std::uintptr_t base = reinterpret_cast< std::uintptr_t >( raw );
+        const std::uintptr_t aligned =
+            (base + sizeof (void *) + Alignment - 1) & ~(Alignment - 1);
+
+        reinterpret_cast< void ** >( aligned )[-1] = raw;
+        return reinterpret_cast< T * >( aligned );
+    }
+
+    void deallocate( T *p, std::size_t )
+    {
+        if (p) ::operator delete( reinterpret_cast< void ** >( p )[-1] );
+    }
+};
+
+
+template< typename T, typename U, std::size_t Alignment >
+bool operator==(
+    const AlignedAllocator< T, Alignment > &,
+    const AlignedAllocator< U, Alignment > & )
+{
+    return true;
+}
+
+
+template< typename T, typename U, std::size_t Alignment >
+bool operator!=(
+    const AlignedAllocator< T, Alignment > &,
+    const AlignedAllocator< U, Alignment > & )
+{
+    return false;
+}
+
+
+} // namespace detail
+
+} // namespace boleo
+
+
+#endif // BOLEO_ALIGNED_HPP_
@@ -30,5 +30,23 @@
 #endif
 
 
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#   define BOLEO_HAS_SSE2 1
+#else
+#   define BOLEO_HAS_SSE2 0
+#endif
+
+
+#if defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#   define BOLEO_HAS_NEON 1
+#else
+#   define BOLEO_HAS_NEON 0
+#endif
+
+
+    // Alignment of SIMD-friendly buffers, in bytes.  Suits AVX, SSE & NEON.
+#define BOLEO_SIMD_ALIGNMENT 32
+
+
 #endif // BOLEO_FEATURES_HPP_
 
@@ -0,0 +1,293 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Minimal fork/join helpers, for splitting loops across threads.
+/*! @file
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_PARALLEL_HPP_
+#define BOLEO_PARALLEL_HPP_
+
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace boleo
+{
+
+namespace detail
+{
+
+
+    // Resolves a requested thread count, where <= 0 means "all cores".
+inline int ThreadCount( int requested )
+{
+    if (requested > 0) return requested;
+
+    const int hw = int( std::thread::hardware_concurrency() );
+    return hw > 0 ? hw : 1;
+}
+
+
+    // Splits [0, count) into at most threads contiguous chunks.
+    /*
+        Calls fn( chunk, begin, end ) once per chunk, with chunk 0 running on
+        the calling thread.  Exceptions thrown by fn are propagated to the
+        caller, after all chunks have finished.
+    */
+template< typename Fn >
+void ParallelFor( int count, int threads, const Fn &fn )
+{
+    threads = ThreadCount( threads );
+    if (threads > count) threads = count;
+    if (threads <= 1)
+    {
+        if (count > 0) fn( 0, 0, count );
+        return;
+    }
+
+    std::vector< std::exception_ptr > errors( threads );
+    std::vector< std::thread > workers;
+    workers.reserve( threads - 1 );
+
+    auto run = [&]( int chunk )
+    {
+        const int begin = int( int64_t( count ) * chunk / threads );
+        const int end = int( int64_t( count ) * (chunk + 1) / threads );
+        try
+        {
+            fn( chunk, begin, end );
+        }
+        catch (...)
+        {
+            errors[chunk] = std::current_exception();
+        }
+    };
+
+    for (int chunk = 1; chunk < threads; ++chunk)
+    {
+        workers.emplace_back( run, chunk );
+    }
+
+    run( 0 );
+
+    for (std::thread &worker: workers) worker.join();
+
+    for (const std::exception_ptr &error: errors)
+    {
+        if (error) std::rethrow_exception( error );
+    }
+}
+
+
+    // Persistent workers, for running ParallelFor()-style loops repeatedly.
+    /*
+        ParallelFor() creates & joins its threads on every call, which can
+        cost as much as a short loop itself.  A WorkerPool's threads sleep
+        between calls to run(), instead.
+
+        run() must not be called concurrently, nor from within fn.
+    */
+class WorkerPool
+{
+public:
+        // Starts threads - 1 workers, where threads <= 0 means "all cores".
+    explicit WorkerPool( int threads );
+
+    WorkerPool( const WorkerPool & ) = delete;
+    WorkerPool &operator=( const WorkerPool & ) = delete;
+
+    ~WorkerPool();
+
+        // Number of chunks run() may split a loop into, including the caller's.
+    int size() const;
+
+        // As ParallelFor( count, size(), fn ).
+    template< typename Fn >
+    void run( int count, const Fn &fn );
+
+private:
+    template< typename Fn >
+    static void Call( const void *fn, int chunk, int begin, int end )
+    {
+        (*static_cast< const Fn * >( fn ))( chunk, begin, end );
+    }
+
+    void work( int chunk );
+    void runChunk( int chunk );
+    void stop();
+
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    uint64_t generation_;   // Incremented by each run(), to start the workers.
+    bool stopping_;
+
+        // The current loop.
+    const void *fn_;
+    void (*call_)( const void *fn, int chunk, int begin, int end );
+    int count_;
+    int chunks_;
+    int pending_;   // Chunks yet to finish, besides the caller's.
+    std::vector< std::exception_ptr > errors_;
+
+    std::vector< std::thread > workers_;
+};
+
+
+inline WorkerPool::WorkerPool( int threads )
+: generation_( 0 ),
+  stopping_( false ),
+  fn_( nullptr ),
+  call_( nullptr ),
+  count_( 0 ),
+  chunks_( 0 ),
+  pending_( 0 )
+{
+    threads = ThreadCount( threads );
+    errors_.resize( threads );
+    workers_.reserve( threads - 1 );
+
+        // Any workers already started must be joined, if another can't be.
+    try
+    {
+        for (int chunk = 1; chunk < threads; ++chunk)
+        {
+            workers_.emplace_back( &WorkerPool::work, this, chunk );
+        }
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+}
+
+
+inline WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+
+inline int WorkerPool::size() const
+{
+    return int( errors_.size() );
+}
+
+
+template< typename Fn >
+void WorkerPool::run( int count, const Fn &fn )
+{
+    const int chunks = count < size() ? count : size();
+    if (chunks <= 1)
+    {
+        if (count > 0) fn( 0, 0, count );
+        return;
+    }
+
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        fn_ = &fn;
+        call_ = &Call< Fn >;
+        count_ = count;
+        chunks_ = chunks;
+        pending_ = chunks - 1;
+        ++generation_;
+    }
+    start_.notify_all();
+
+    runChunk( 0 );
+
+    {
+        std::unique_lock< std::mutex > lock( mutex_ );
+        done_.wait( lock, [this]{ return pending_ == 0; } );
+    }
+
+        // As with ParallelFor(), the first chunk's error is propagated.
+    std::exception_ptr error;
+    for (int chunk = 0; chunk < chunks; ++chunk)
+    {
+        if (!error) error = errors_[chunk];
+        errors_[chunk] = nullptr;
+    }
+
+    if (error) std::rethrow_exception( error );
+}
+
+
+inline void WorkerPool::work( int chunk )
+{
+    uint64_t generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock< std::mutex > lock( mutex_ );
+            start_.wait( lock,
+                [&]{ return stopping_ || generation_ != generation; } );
+            if (stopping_) return;
+
+            generation = generation_;
+            if (chunk >= chunks_) continue;
+        }
+
+        runChunk( chunk );
+
+        bool last;
+        {
+            std::lock_guard< std::mutex > lock( mutex_ );
+            last = --pending_ == 0;
+        }
+        if (last) done_.notify_one();
+    }
+}
+
+
+inline void WorkerPool::runChunk( int chunk )
+{
+    const int begin = int( int64_t( count_ ) * chunk / chunks_ );
+    const int end = int( int64_t( count_ ) * (chunk + 1) / chunks_ );
+    try
+    {
+        call_( fn_, chunk, begin, end );
+    }
+    catch (...)
+    {
+        errors_[chunk] = std::current_exception();
+    }
+}
+
+
+inline void WorkerPool::stop()
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        stopping_ = true;
+    }
+    start_.notify_all();
+
+    for (std::thread &worker: workers_) worker.join();
+    workers_.clear();
+}
+
+
+} // namespace detail
+
+} // namespace boleo
+
+
+#endif // BOLEO_PARALLEL_HPP_
@@ -0,0 +1,715 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides publish/subscribe fan-out of Tango frames, via shared buffers.
+/*! @file
+
+    Data passed to Tango callbacks is only valid for the duration of the
+    callback, so it must be copied.  TangoFrameHub makes exactly one copy,
+    into a pooled, reference-counted frame, which is then shared by every
+    subscriber.  Once the last reference is released, the frame returns to
+    its pool, with its storage intact for reuse.
+
+    Each Subscription has its own queue, with a capacity & overflow policy,
+    and its own counts of delivered & dropped frames.  So, a slow consumer
+    only affects itself.
+
+    @code
+
+        TangoFrameHub hub;
+
+            // In the Tango callbacks:
+        hub.onPointCloudAvailable( cloud );
+        hub.onPoseAvailable( pose );
+
+            // On the render thread, only the most recent cloud matters.
+        auto render = hub.clouds().subscribe( LatestOnly() );
+
+            // While the recorder wants everything it can get.
+        auto record = hub.clouds().subscribe( Bounded( 30 ) );
+
+        CloudFramePtr frame;
+        while (record->pop( frame ))
+        {
+            TangoPointCloud view = frame->view();
+            write( &view );
+        }
+
+    @endcode
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_FRAME_HUB_HPP_
+#define BOLEO_FRAME_HUB_HPP_
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+class PooledFrame;
+
+
+namespace detail
+{
+
+        // Interface for asynchronous waits on a Subscription.
+        /*
+            claim() is called with the Subscription locked, and returns true
+            if this wake-up completes the wait.  If so, wake() is then called
+            with nothing locked.  FrameHub::publish() defers wake() until it
+            has pushed to every subscriber, chaining claimed waiters via
+            next_woken, so publishing allocates nothing extra.
+        */
+    class SubscriptionWaiter
+    {
+    public:
+        virtual bool claim( bool closed ) = 0;
+        virtual void wake() = 0;
+
+        SubscriptionWaiter *next_woken = nullptr;
+
+    protected:
+        ~SubscriptionWaiter() {}
+    };
+
+
+        // Non-template part of FramePool, shared with outstanding frames.
+    class FramePoolCore
+    {
+    public:
+        explicit FramePoolCore( int max_free );
+        ~FramePoolCore();
+
+        PooledFrame *take();
+        void release( PooledFrame *frame );
+        int freeCount() const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::vector< PooledFrame * > free_;
+        int max_free_;
+    };
+
+}
+
+
+    //! Base class of frames which can be shared via FrameRef & FramePool.
+class PooledFrame
+{
+public:
+    PooledFrame();
+    PooledFrame( const PooledFrame & ) = delete;
+    PooledFrame &operator=( const PooledFrame & ) = delete;
+    virtual ~PooledFrame();
+
+        //! Number of FrameRefs to this frame.
+    int useCount() const;
+
+private:
+    template< typename > friend class FrameRef;
+    template< typename > friend class FramePool;
+
+    void addRef() const;
+    void release() const;
+
+    mutable std::atomic< int > refs_;
+    std::weak_ptr< detail::FramePoolCore > pool_;
+};
+
+
+    //! A reference-counted handle to a PooledFrame.
+    /*!
+        FrameRef< const T > is the immutable form, shared among subscribers.
+        A FrameRef< T > converts to FrameRef< const T >, but not vice-versa.
+    */
+template<
+    typename T          //!< Frame type, optionally const.
+>
+class FrameRef
+{
+public:
+    typedef T element_type;
+
+    FrameRef()
+    : frame_( nullptr )
+    {
+    }
+
+    FrameRef( const FrameRef &other )
+    : frame_( other.frame_ )
+    {
+        if (frame_) frame_->addRef();
+    }
+
+    FrameRef( FrameRef &&other )
+    : frame_( other.frame_ )
+    {
+        other.frame_ = nullptr;
+    }
+
+    template<
+        typename U,
+        typename = typename std::enable_if<
+            std::is_convertible< U *, T * >::value >::type
+    >
+    FrameRef( FrameRef< U > &&other )
+    : frame_( other.frame_ )
+    {
+        other.frame_ = nullptr;
+    }
+
+    template<
+        typename U,
+        typename = typename std::enable_if<
+            std::is_convertible< U *, T * >::value >::type
+    >
+    FrameRef( const FrameRef< U > &other )
+    : frame_( other.frame_ )
+    {
+        if (frame_) frame_->addRef();
+    }
+
+    FrameRef &operator=( FrameRef other )
+    {
+        std::swap( frame_, other.frame_ );
+        return *this;
+    }
+
+    ~FrameRef()
+    {
+        if (frame_) frame_->release();
+    }
+
+        //! Drops the reference, returning the frame to its pool if it's last.
+    void reset()
+    {
+        FrameRef().swap( *this );
+    }
+
+    void swap( FrameRef &other )
+    {
+        std::swap( frame_, other.frame_ );
+    }
+
+    T *get() const          { return frame_; }
+    T &operator*() const    { return *frame_; }
+    T *operator->() const   { return frame_; }
+
+    explicit operator bool() const
+    {
+        return frame_ != nullptr;
+    }
+
+private:
+    template< typename > friend class FrameRef;
+    template< typename > friend class FramePool;
+
+        // Adopts a frame whose reference count has already been incremented.
+    explicit FrameRef( T *frame )
+    : frame_( frame )
+    {
+    }
+
+    T *frame_;
+};
+
+
+    //! A pool of recycled frames, of type Frame.
+    /*!
+        acquire() never blocks; if no free frame is available, a new one is
+        allocated.  Released frames are retained, up to max_free, with
+        whatever storage they've accumulated.  The pool may be destroyed
+        before its outstanding frames, which are then deleted on release.
+    */
+template<
+    typename Frame      //!< Must derive from PooledFrame.
+>
+class FramePool
+{
+public:
+    static_assert( std::is_base_of< PooledFrame, Frame >::value,
+        "Frame must derive from PooledFrame" );
+
+    explicit FramePool( int max_free = 4 )
+    : core_( std::make_shared< detail::FramePoolCore >( max_free ) )
+    {
+    }
+
+        //! Returns a writable, unshared frame.
+    FrameRef< Frame > acquire()
+    {
+        PooledFrame *frame = core_->take();
+        if (!frame)
+        {
+            frame = new Frame();
+            frame->pool_ = core_;
+        }
+
+        frame->addRef();
+        return FrameRef< Frame >( static_cast< Frame * >( frame ) );
+    }
+
+        //! Number of frames awaiting reuse.
+    int freeCount() const
+    {
+        return core_->freeCount();
+    }
+
+private:
+    std::shared_ptr< detail::FramePoolCore > core_;
+};
+
+
+    //! An immutable copy of a TangoPointCloud.
+class CloudFrame: public PooledFrame
+{
+public:
+        //! Copies cloud, reusing existing storage.
+    void assign( const TangoPointCloud *cloud );
+
+    double timestamp() const;
+
+        //! Number of points.
+    int size() const;
+
+        //! Returns a TangoPointCloud referencing this frame's storage.
+        /*!
+            Suitable for PointCloud_toPcl() & co.  Valid only as long as
+            a reference to this frame is held.
+        */
+    TangoPointCloud view() const;
+
+private:
+    TangoPointCloud header_;
+    std::vector< float > points_;
+};
+
+
+    //! An immutable copy of a TangoImageBuffer.
+class ImageFrame: public PooledFrame
+{
+public:
+        //! Copies buffer, reusing existing storage.
+    void assign( TangoCameraId camera, const TangoImageBuffer *buffer );
+
+    TangoCameraId camera() const;
+
+    double timestamp() const;
+
+        //! Returns a TangoImageBuffer referencing this frame's storage.
+        /*!
+            Valid only as long as a reference to this frame is held.
+        */
+    TangoImageBuffer view() const;
+
+private:
+    TangoCameraId camera_;
+    TangoImageBuffer header_;
+    std::vector< uint8_t > data_;
+};
+
+
+    //! An immutable copy of a TangoPoseData.
+class PoseFrame: public PooledFrame
+{
+public:
+    void assign( const TangoPoseData *pose );
+
+    double timestamp() const;
+
+    const TangoPoseData &pose() const;
+
+private:
+    TangoPoseData pose_;
+};
+
+
+typedef FrameRef< const CloudFrame > CloudFramePtr; //!< Shared cloud.
+typedef FrameRef< const ImageFrame > ImageFramePtr; //!< Shared image.
+typedef FrameRef< const PoseFrame >  PoseFramePtr;  //!< Shared pose.
+
+
+    //! Returns the size, in bytes, of the pixel data of a TangoImageBuffer.
+    /*!
+        @throws std::invalid_argument for unrecognized formats.
+    */
+size_t ImageBuffer_size( const TangoImageBuffer *buffer );
+
+
+    //! What to do when a frame arrives for a full Subscription queue.
+enum OverflowPolicy
+{
+    drop_oldest,    //!< Discard the oldest queued frame.
+    drop_newest     //!< Discard the arriving frame.
+};
+
+
+    //! Queueing behavior of a Subscription.
+struct QueuePolicy
+{
+    int capacity;               //!< Maximum queued frames (>= 1).
+    OverflowPolicy overflow;    //!< Behavior when full.
+};
+
+
+    //! A queue of 1, which always holds the most recent frame.
+inline QueuePolicy LatestOnly()
+{
+    QueuePolicy result = { 1, drop_oldest };
+    return result;
+}
+
+
+    //! A queue of the given capacity.
+inline QueuePolicy Bounded(
+    int capacity,                           //!< Maximum queued frames.
+    OverflowPolicy overflow = drop_oldest   //!< Behavior when full.
+)
+{
+    QueuePolicy result = { capacity, overflow };
+    return result;
+}
+
+
+    //! Delivery statistics of a Subscription.
+struct SubscriptionStats
+{
+    int64_t delivered;  //!< Frames queued.
+    int64_t dropped;    //!< Frames discarded due to overflow.
+    int64_t popped;     //!< Frames removed by the subscriber.
+};
+
+
+template< typename Frame > class FrameHub;
+
+
+    //! A subscriber's queue of frames from a FrameHub.
+    /*!
+        Member functions may be called from any thread.  Destroying the last
+        shared_ptr to a Subscription, or calling close(), unsubscribes it.
+    */
+template<
+    typename Frame      //!< Frame type.
+>
+class Subscription
+{
+public:
+    typedef FrameRef< const Frame > pointer;
+    typedef std::function< bool ( const Frame & ) > filter_type;
+
+    Subscription( const QueuePolicy &policy, filter_type filter )
+    : policy_( policy ),
+      filter_( std::move( filter ) ),
+      waiter_( nullptr ),
+      closed_( false )
+    {
+        if (policy_.capacity < 1) policy_.capacity = 1;
+        stats_.delivered = 0;
+        stats_.dropped = 0;
+        stats_.popped = 0;
+    }
+
+        //! Removes the next frame, if one is queued.
+    bool tryPop( pointer &frame )
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        return popLocked( frame );
+    }
+
+        //! Waits for the next frame.
+        /*!
+            @returns false, once closed and empty.
+        */
+    bool pop( pointer &frame )
+    {
+        std::unique_lock< std::mutex > lock( mutex_ );
+        ready_.wait( lock, [this]{ return closed_ || !queue_.empty(); } );
+        return popLocked( frame );
+    }
+
+        //! Waits up to timeout for the next frame.
+    template< typename Rep, typename Period >
+    bool popFor(
+        pointer &frame,
+        const std::chrono::duration< Rep, Period > &timeout )
+    {
+        std::unique_lock< std::mutex > lock( mutex_ );
+        ready_.wait_for( lock, timeout,
+            [this]{ return closed_ || !queue_.empty(); } );
+
+        return popLocked( frame );
+    }
+
+        //! Stops delivery & wakes any waiting threads.
+    void close()
+    {
+        detail::SubscriptionWaiter *woken = nullptr;
+        {
+            std::lock_guard< std::mutex > lock( mutex_ );
+            closed_ = true;
+            if (waiter_ && waiter_->claim( true )) std::swap( woken, waiter_ );
+        }
+        ready_.notify_all();
+        if (woken) woken->wake();
+    }
+
+        //! Registers a waiter, to be woken by the next frame or close().
+        /*!
+            Used by coroutine.hpp.  Returns false without registering, if a
+            frame is already queued or the subscription is closed.
+
+            @throws std::logic_error if another waiter is registered.
+        */
+    bool asyncWait( detail::SubscriptionWaiter *waiter )
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        if (closed_ || !queue_.empty()) return false;
+
+        if (waiter_ && waiter_ != waiter)
+        {
+            throw std::logic_error( "Subscription already has a waiter" );
+        }
+
+        waiter_ = waiter;
+        return true;
+    }
+
+        //! Unregisters waiter, if it's still registered.
+    void cancelWait( detail::SubscriptionWaiter *waiter )
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        if (waiter_ == waiter) waiter_ = nullptr;
+    }
+
+    bool closed() const
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        return closed_;
+    }
+
+        //! Number of frames queued.
+    int size() const
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        return int( queue_.size() );
+    }
+
+    SubscriptionStats stats() const
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        return stats_;
+    }
+
+private:
+    friend class FrameHub< Frame >;
+
+        // Called by FrameHub.  Returns false, if closed.  A waiter claimed
+        //  by frame is prepended to woken, for the caller to wake.
+    bool push( const pointer &frame, detail::SubscriptionWaiter *&woken )
+    {
+        if (filter_ && !filter_( *frame )) return true;
+
+        {
+            std::lock_guard< std::mutex > lock( mutex_ );
+            if (closed_) return false;
+
+            if (int( queue_.size() ) >= policy_.capacity)
+            {
+                ++stats_.dropped;
+                if (policy_.overflow == drop_newest) return true;
+                queue_.pop_front();
+            }
+
+            queue_.push_back( frame );
+            ++stats_.delivered;
+
+            if (waiter_ && waiter_->claim( false ))
+            {
+                waiter_->next_woken = woken;
+                woken = waiter_;
+                waiter_ = nullptr;
+            }
+        }
+
+        ready_.notify_one();
+        return true;
+    }
+
+    bool popLocked( pointer &frame )
+    {
+        if (queue_.empty()) return false;
+
+        frame = std::move( queue_.front() );
+        queue_.pop_front();
+        ++stats_.popped;
+        return true;
+    }
+
+    QueuePolicy policy_;
+    filter_type filter_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque< pointer > queue_;
+    SubscriptionStats stats_;
+    detail::SubscriptionWaiter *waiter_;
+    bool closed_;
+};
+
+
+    //! Fans out each published frame to all current subscribers.
+template<
+    typename Frame      //!< Frame type.
+>
+class FrameHub
+{
+public:
+    typedef FrameRef< const Frame > pointer;
+    typedef Subscription< Frame > subscription_type;
+    typedef typename subscription_type::filter_type filter_type;
+
+        //! Adds a subscriber, which receives frames published from now on.
+        /*!
+            @param filter if set, only frames for which it returns true are
+            queued.  It's called on the publishing thread.
+        */
+    std::shared_ptr< subscription_type > subscribe(
+        const QueuePolicy &policy,
+        filter_type filter = filter_type() )
+    {
+        auto result = std::make_shared< subscription_type >(
+            policy, std::move( filter ) );
+
+        std::lock_guard< std::mutex > lock( mutex_ );
+        subscribers_.push_back( result );
+        return result;
+    }
+
+        //! Shares frame with every subscriber.
+    void publish( const pointer &frame )
+    {
+        detail::SubscriptionWaiter *woken = nullptr;
+        {
+            std::lock_guard< std::mutex > lock( mutex_ );
+
+            auto live = subscribers_.begin();
+            for (auto it = subscribers_.begin(); it != subscribers_.end(); ++it)
+            {
+                std::shared_ptr< subscription_type > subscriber = it->lock();
+                if (subscriber && subscriber->push( frame, woken ))
+                {
+                    if (live != it) *live = std::move( *it );
+                    ++live;
+                }
+            }
+
+            subscribers_.erase( live, subscribers_.end() );
+        }
+
+            // Woken without mutex_ held, since a waiter may resume a
+            //  coroutine (see coroutine.hpp), which may subscribe.
+        while (woken)
+        {
+            detail::SubscriptionWaiter *next = woken->next_woken;
+            woken->wake();
+            woken = next;
+        }
+    }
+
+        //! Number of subscribers, as of the last publish().
+    int subscriberCount() const
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        return int( subscribers_.size() );
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector< std::weak_ptr< subscription_type > > subscribers_;
+};
+
+
+    //! Copies Tango callback data into pooled frames & publishes them.
+    /*!
+        Call the on*Available() functions from the corresponding Tango
+        callbacks.  Each performs a single copy, regardless of the number of
+        subscribers, and none if there are no subscribers.
+
+        Since an exception can't propagate through a C callback, they don't
+        throw.  A frame which can't be copied or published (e.g. due to an
+        unrecognized image format, or bad_alloc) is counted by dropped().
+    */
+class TangoFrameHub
+{
+public:
+        //! @param pool_size is the number of free frames retained, per type.
+    explicit TangoFrameHub( int pool_size = 4 );
+
+    void onPointCloudAvailable( const TangoPointCloud *cloud ) noexcept;
+    void onFrameAvailable(
+        TangoCameraId camera,
+        const TangoImageBuffer *buffer ) noexcept;
+    void onPoseAvailable( const TangoPoseData *pose ) noexcept;
+
+        //! Frames which on*Available() failed to copy or publish.
+    int64_t dropped() const;
+
+    FrameHub< CloudFrame > &clouds();
+    FrameHub< ImageFrame > &images();
+    FrameHub< PoseFrame > &poses();
+
+        //! Subscribes to images from a single camera.
+    std::shared_ptr< Subscription< ImageFrame > > subscribeImages(
+        TangoCameraId camera,
+        const QueuePolicy &policy );
+
+        //! Subscribes to poses of a single frame pair.
+    std::shared_ptr< Subscription< PoseFrame > > subscribePoses(
+        const TangoCoordinateFramePair &frame_pair,
+        const QueuePolicy &policy );
+
+private:
+    FramePool< CloudFrame > cloud_pool_;
+    FramePool< ImageFrame > image_pool_;
+    FramePool< PoseFrame > pose_pool_;
+
+    FrameHub< CloudFrame > clouds_;
+    FrameHub< ImageFrame > images_;
+    FrameHub< PoseFrame > poses_;
+
+    std::atomic< int64_t > dropped_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_FRAME_HUB_HPP_
@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides timestamp matching of clouds, images & poses from a hub.
+/*! @file
+
+    FrameSynchronizer pairs each point cloud published by a TangoFrameHub
+    with the image and/or pose nearest to it in time, provided they lie
+    within a tolerance.  Matched frames are delivered as FrameRefs, so the
+    payloads are never copied.
+
+    Each stream has its own bounded Subscription, so the Tango callbacks
+    never touch the synchronizer's state.  Matching happens on the consuming
+    thread, in tryPop(), by binary search over each stream's frames, which
+    are kept sorted by timestamp.
+
+    A cloud is matched once each other stream has delivered a frame at or
+    after its timestamp, since no later frame can then be nearer.  The wait
+    is bounded, though: once a later cloud arrives more than the tolerance
+    after it, the match is decided with the frames already present, since
+    any partner should have arrived by then.  So a stalled stream leaves
+    clouds unmatched, rather than holding them until they overflow.  Clouds
+    with no partner within the tolerance are discarded & counted as
+    unmatched.
+
+    Images & poses too old to match the next cloud are discarded as they're
+    taken, so the queues hold only candidates.  Frames discarded because a
+    queue was nonetheless full are counted as dropped, except for candidates
+    discarded while no cloud awaits them (e.g., after the last cloud), which
+    are merely the oldest of those running ahead.
+
+    @code
+
+        TangoFrameHub hub;
+
+        SyncParams params;
+        params.tolerance = 0.015;
+        FrameSynchronizer sync( hub, params );
+
+            // Once per rendered frame:
+        SyncedFrames frames;
+        while (sync.tryPop( frames ))
+        {
+            colorize( frames.cloud->view(), frames.image->view(),
+                frames.pose->pose() );
+        }
+
+    @endcode
+
+    @note
+    tryPop() & stats() must be called from a single thread, although frames
+    may be published to the hub concurrently.  There's no lock-free path:
+    each Tango callback locks the hub's mutex, then that of each Subscription
+    in turn (see frame_hub.hpp).  tryPop() holds a Subscription's lock only
+    while taking its queued frames, which bounds how long it delays one.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_FRAME_SYNC_HPP_
+#define BOLEO_FRAME_SYNC_HPP_
+
+
+#include "boleo/frame_hub.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Settings for a FrameSynchronizer.
+struct SyncParams
+{
+        //! Largest timestamp difference of a match, in seconds.
+    double tolerance = 0.02;
+
+    bool images = true;     //!< Whether to match an image with each cloud.
+    bool poses = true;      //!< Whether to match a pose with each cloud.
+
+        //! Camera whose images are matched.
+    TangoCameraId camera = TANGO_CAMERA_COLOR;
+
+        //! Frame pair of the poses matched.
+    TangoCoordinateFramePair pose_frames = {
+        TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+        TANGO_COORDINATE_FRAME_DEVICE };
+
+        //! Clouds queued awaiting a match.  With 1, there's no room for the
+        //!  later cloud which bounds the wait, so a stalled stream drops them.
+    int cloud_capacity = 4;
+    int image_capacity = 8;     //!< Images retained as candidates.
+    int pose_capacity = 64;     //!< Poses retained as candidates.
+};
+
+
+    //! A cloud, with the frames matched to it.
+    /*!
+        image & pose are null, if not enabled in SyncParams.
+    */
+struct SyncedFrames
+{
+    CloudFramePtr cloud;
+    ImageFramePtr image;
+    PoseFramePtr pose;
+};
+
+
+    //! Statistics of a FrameSynchronizer.
+struct SyncStats
+{
+    int64_t matched = 0;        //!< Tuples delivered.
+    int64_t unmatched = 0;      //!< Clouds without partners in tolerance.
+    int64_t dropped_clouds = 0; //!< Clouds discarded by full queues.
+    int64_t dropped_images = 0; //!< Images discarded by full queues.
+    int64_t dropped_poses = 0;  //!< Poses discarded by full queues.
+};
+
+
+    //! Matches clouds with images & poses, by timestamp.
+class FrameSynchronizer
+{
+public:
+        //! Subscribes to hub, until destroyed.
+        /*!
+            @throws std::invalid_argument for out-of-range params.
+        */
+    explicit FrameSynchronizer(
+        TangoFrameHub &hub,                     //!< Source of frames.
+        const SyncParams &params = SyncParams() //!< Settings.
+    );
+
+        //! Retrieves the next matched tuple, if one is ready.
+        /*!
+            Tuples are delivered in order of cloud timestamp.  Clouds found
+            to be unmatched are discarded along the way.
+        */
+    bool tryPop( SyncedFrames &result );
+
+        //! Statistics, since construction.
+    SyncStats stats() const;
+
+        //! Settings supplied at construction.
+    const SyncParams &params() const;
+
+private:
+        // A subscription, & the frames taken from it, by timestamp.
+    template< typename Frame >
+    struct Stream
+    {
+        std::shared_ptr< Subscription< Frame > > subscription;
+        std::vector< FrameRef< const Frame > > frames;
+        int capacity;
+        int64_t dropped;    // From frames, beyond the subscription's.
+    };
+
+    SyncParams params_;
+    double last_cloud_;     // Timestamp of the last cloud matched or not.
+    Stream< CloudFrame > clouds_;
+    Stream< ImageFrame > images_;
+    Stream< PoseFrame > poses_;
+    int64_t matched_;
+    int64_t unmatched_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_FRAME_SYNC_HPP_
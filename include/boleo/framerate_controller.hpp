@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Adjusts the depth framerate, in response to consumer backpressure.
+/*! @file
+
+    Rather than dropping point clouds after they've been delivered & copied,
+    FramerateController lowers config_runtime_depth_framerate when the
+    consumer falls behind, and raises it again once the consumer has been
+    keeping up for a while.
+
+    Call update() once per processed cloud, from the consuming thread, with
+    the depth of its input queue and the latency of the cloud just processed
+    (e.g. the time from the callback to the end of processing).
+
+    @code
+
+        UniqueConfig runtime =
+            WrapConfig( TangoService_getConfig( TANGO_CONFIG_RUNTIME ) );
+
+        FramerateController controller( runtime.get() );
+
+        while (Cloud cloud = queue.pop())
+        {
+            process( cloud );
+            controller.update( queue.size(), Now() - cloud.received );
+        }
+
+        LOGI( "Sustained throughput: %.2f Hz", controller.throughput() );
+
+    @endcode
+
+    @note
+    This class is not thread-safe.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_FRAMERATE_CONTROLLER_HPP_
+#define BOLEO_FRAMERATE_CONTROLLER_HPP_
+
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Policy settings for FramerateController.
+    /*!
+        A sample is overloaded if either threshold is reached, in which case
+        the framerate is lowered immediately.  It's raised only after
+        raise_samples consecutive samples are underloaded on both counts.
+        After any change, hold_samples samples are ignored, while the effect
+        of the change propagates through the consumer's queue.
+    */
+struct FramerateParams
+{
+    int32_t min_framerate = 1;      //!< Lower bound, in Hz (>= 1).
+    int32_t max_framerate = 5;      //!< Upper bound, in Hz.
+    int32_t step = 1;               //!< Amount of each adjustment, in Hz.
+
+    int high_queue_depth = 2;       //!< Overloaded at or above this depth.
+    int low_queue_depth = 0;        //!< Underloaded at or below this depth.
+    double high_latency = 0.25;     //!< Overloaded at or above, in seconds.
+    double low_latency = 0.1;       //!< Underloaded at or below, in seconds.
+
+    int raise_samples = 10;         //!< Underloaded samples needed to raise.
+    int hold_samples = 3;           //!< Samples ignored after a change.
+
+    double throughput_window = 2.0; //!< Span of throughput(), in seconds.
+};
+
+
+    //! Drives config_runtime_depth_framerate, based on consumer backpressure.
+class FramerateController
+{
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+        //! Starts at params.max_framerate, which is applied immediately.
+        /*!
+            @param runtime_config should be obtained via TANGO_CONFIG_RUNTIME.
+            It's not owned by this object.
+
+            @throws std::invalid_argument for out-of-range params.
+            @throws TangoException if the framerate can't be applied.
+        */
+    explicit FramerateController(
+        TangoConfig runtime_config,
+        const FramerateParams &params = FramerateParams()
+    );
+
+        //! Records a processed cloud & adjusts the framerate, if warranted.
+        /*!
+            @returns the framerate now in effect.
+            @throws TangoException if a new framerate can't be applied.
+        */
+    int32_t update(
+        int queue_depth,    //!< Clouds awaiting processing.
+        double latency      //!< Seconds from delivery to end of processing.
+    );
+
+        //! The framerate now in effect, in Hz.
+    int32_t framerate() const;
+
+        //! Rate of calls to update(), over the throughput window, in Hz.
+        /*!
+            Counts calls within the window ending now, so this decays to 0
+            once update() is no longer being called.  Until a full window has
+            elapsed since construction, the window starts at construction.
+        */
+    double throughput() const;
+
+        //! Number of times the framerate has been changed.
+    int64_t adjustments() const;
+
+        //! Settings supplied at construction.
+    const FramerateParams &params() const;
+
+private:
+    void apply( int32_t framerate );
+
+    TangoConfig config_;
+    FramerateParams params_;
+    int32_t framerate_;
+    int underloaded_;
+    int hold_;
+    int64_t adjustments_;
+    clock_type::time_point started_;
+    std::deque< clock_type::time_point > completions_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_FRAMERATE_CONTROLLER_HPP_
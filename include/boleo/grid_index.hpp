@@ -0,0 +1,220 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides a uniform-grid spatial index, for neighbor queries.
+/*! @file
+
+    GridIndex buckets points into cubic cells, via a spatial hash.  It's
+    built with a counting sort: one pass to count the points per bucket, a
+    prefix sum, then one pass to scatter the points into a flat array, so
+    that each bucket's points are contiguous.  There are no per-node
+    allocations, and rebuilding for each frame reuses the previous frame's
+    storage.
+
+    Since the counting pass needs only each point's coordinates, it can be
+    fused with conversion.  pcl.hpp provides a PointCloud_toPcl() overload
+    which does this.
+
+    @code
+
+        GridIndex index( 0.05f );   // 5 cm cells.
+
+            // Per frame:
+        index.build( cloud );
+
+        std::vector< int > indices;
+        std::vector< float > distances_sq;
+        index.nearestKSearch( query, 8, indices, distances_sq );
+
+    @endcode
+
+    Indices refer to the order in which points were added, which for
+    build() is that of TangoPointCloud::points.  Queries are fastest when
+    the cell size is about the search radius.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_GRID_INDEX_HPP_
+#define BOLEO_GRID_INDEX_HPP_
+
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+class PointCloudSoA;
+
+
+    //! A spatial hash of points, supporting radius & k-nearest queries.
+    /*!
+        Queries may be issued concurrently, but not during a build.
+    */
+class GridIndex
+{
+public:
+        //! @param cell_size is the edge length of each cell, in meters.
+    explicit GridIndex( float cell_size = 0.05f );
+
+        //! Changes the cell size, which takes effect at the next build.
+    void setCellSize( float cell_size );
+
+    float cellSize() const;
+
+        //! Indexes the points of a TangoPointCloud.
+    void build( const TangoPointCloud *cloud );
+
+        //! Indexes the points of a PointCloudSoA.
+    void build( const PointCloudSoA &cloud );
+
+        //! Starts a build of size points, to be supplied via add().
+    void begin( int size );
+
+        //! Supplies a point.  Each index in [0, size) must be added once.
+    void add( int index, float x, float y, float z );
+
+        //! Completes a build started by begin().
+    void finish();
+
+        //! Number of points indexed.
+    int size() const;
+
+        //! Finds all points within radius of point.
+        /*!
+            Results are unordered.  indices & distances_sq are replaced.
+
+            @returns the number of points found.
+        */
+    int radiusSearch(
+        const float *point,                 //!< Query (x, y, z).
+        float radius,                       //!< Search radius.
+        std::vector< int > &indices,        //!< Receives point indices.
+        std::vector< float > &distances_sq  //!< Receives squared distances.
+    ) const;
+
+        //! Finds the k points nearest to point.
+        /*!
+            Results are in order of increasing distance.  indices &
+            distances_sq are replaced.
+
+            @returns the number of points found, which is less than k only
+            if fewer than k points are indexed.
+        */
+    int nearestKSearch(
+        const float *point,                 //!< Query (x, y, z).
+        int k,                              //!< Number of neighbors wanted.
+        std::vector< int > &indices,        //!< Receives point indices.
+        std::vector< float > &distances_sq  //!< Receives squared distances.
+    ) const;
+
+private:
+        // A point, in bucket order.
+    struct Entry
+    {
+        float x;
+        float y;
+        float z;
+        int32_t index;
+    };
+
+        // Cell coordinates are limited to 21 bits each.
+    static const int32_t cell_limit = 1 << 20;
+
+    static int32_t ToCell( float coord, float inverse_size );
+    static uint64_t CellKey( int32_t cx, int32_t cy, int32_t cz );
+    uint32_t bucketOf( uint64_t key ) const;
+
+    template< typename Fn >
+    void forEachInCell( int32_t cx, int32_t cy, int32_t cz, Fn &fn ) const;
+
+    float cell_size_;
+    float inverse_size_;    // Of the build in progress, or last built.
+    int size_;
+    int bits_;              // log2 of the number of buckets.
+    int32_t min_cell_[3];
+    int32_t max_cell_[3];
+
+    std::vector< uint64_t > keys_;      // Per added point.
+    std::vector< float > staged_;       // Per added point: x, y, z.
+    std::vector< uint32_t > start_;     // Per bucket, plus 1: first entry.
+    std::vector< uint32_t > cursor_;    // Per bucket: scatter position.
+    std::vector< Entry > entries_;
+    std::vector< uint64_t > entry_keys_;
+};
+
+
+
+////////////////////////////////////////////////////////////
+// Inline Definitions
+////////////////////////////////////////////////////////////
+
+inline int32_t GridIndex::ToCell( float coord, float inverse_size )
+{
+        // Also maps NaN to the lowest cell.
+    const float cell = std::floor( coord*inverse_size );
+    if (!(cell > float( -cell_limit ))) return -cell_limit;
+    if (cell > float( cell_limit - 1 )) return cell_limit - 1;
+    return int32_t( cell );
+}
+
+
+inline uint64_t GridIndex::CellKey( int32_t cx, int32_t cy, int32_t cz )
+{
+    return uint64_t( cx + cell_limit )
+        | uint64_t( cy + cell_limit ) << 21
+        | uint64_t( cz + cell_limit ) << 42;
+}
+
+
+inline uint32_t GridIndex::bucketOf( uint64_t key ) const
+{
+    return uint32_t( (key*UINT64_C( 0x9E3779B97F4A7C15 )) >> (64 - bits_) );
+}
+
+
+inline void GridIndex::add( int index, float x, float y, float z )
+{
+    const int32_t cell[3] = {
+        ToCell( x, inverse_size_ ),
+        ToCell( y, inverse_size_ ),
+        ToCell( z, inverse_size_ ) };
+
+    for (int a = 0; a < 3; ++a)
+    {
+        if (cell[a] < min_cell_[a]) min_cell_[a] = cell[a];
+        if (cell[a] > max_cell_[a]) max_cell_[a] = cell[a];
+    }
+
+    const uint64_t key = CellKey( cell[0], cell[1], cell[2] );
+    keys_[index] = key;
+    ++start_[ bucketOf( key ) + 1 ];
+
+    float *staged = &staged_[ 3*size_t( index ) ];
+    staged[0] = x;
+    staged[1] = y;
+    staged[2] = z;
+}
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_GRID_INDEX_HPP_
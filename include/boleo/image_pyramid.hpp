@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides grayscale Gaussian pyramids of TangoImageBuffers.
+/*! @file
+
+    ImagePyramid reads the luma (Y) plane of a YV12 or NV21 image in place,
+    respecting its stride, so level 0 is not copied.  RGBA images are
+    converted to gray, instead.
+
+    The remaining levels are built in a single pass over the source rows:
+    each output row of a level is fed straight into the next level's filter,
+    so all levels are produced while their inputs are still in cache.  The
+    filter & border handling match cv::pyrDown() (a 5x5 binomial kernel,
+    with reflected borders), and run 8 pixels at a time with SSE2 or NEON.
+
+    Level buffers are retained from one frame to the next.
+
+    @code
+
+        ImagePyramid pyramid;
+
+            // In the TangoService_connectOnFrameAvailable() callback.
+        pyramid.build( buffer );
+        for (int i = 0; i < pyramid.levels(); ++i)
+        {
+            const PyramidLevel &level = pyramid.level( i );
+            track( level.data, level.width, level.height, level.stride );
+        }
+
+    @endcode
+
+    @note
+    Level 0 may reference the TangoImageBuffer's data, and so is valid only
+    as long as the buffer is.  If an ImageFrame is used (see frame_hub.hpp),
+    hold a reference to it while the pyramid is in use.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_IMAGE_PYRAMID_HPP_
+#define BOLEO_IMAGE_PYRAMID_HPP_
+
+
+#include "boleo/detail/aligned.hpp"
+#include "boleo/detail/features.hpp"
+
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Settings for ImagePyramid.
+struct PyramidParams
+{
+    int levels = 4;     //!< Maximum number of levels, including level 0.
+    int min_size = 16;  //!< Levels narrower or shorter are not built.
+};
+
+
+    //! A rectangle of level-0 pixels.
+struct PyramidRoi
+{
+    int x;          //!< Left column.
+    int y;          //!< Top row.
+    int width;      //!< In columns.
+    int height;     //!< In rows.
+};
+
+
+    //! A view of 1 level of an ImagePyramid.
+struct PyramidLevel
+{
+    const uint8_t *data;    //!< Top-left pixel.
+    int width;              //!< In pixels.
+    int height;             //!< In rows.
+    int stride;             //!< In bytes, from one row to the next.
+
+        //! Position of data within the whole level, which is nonzero only
+        //!  when built from a PyramidRoi.
+    int x;
+    int y;
+};
+
+
+    //! A grayscale Gaussian image pyramid.
+class ImagePyramid
+{
+public:
+        //! @throws std::invalid_argument for out-of-range params.
+    explicit ImagePyramid( const PyramidParams &params = PyramidParams() );
+
+        //! Rebuilds the pyramid from all of image.
+        /*!
+            @throws std::invalid_argument for unrecognized formats.
+        */
+    void build( const TangoImageBuffer *image );
+
+        //! Rebuilds the pyramid from a region of image.
+        /*!
+            The region's top-left corner is rounded down to a multiple of
+            2^(params().levels - 1), so that every level stays aligned with
+            that of the whole image.  It's also clipped to the image.
+
+            Pixels outside the region don't contribute, so values within
+            2 pixels of its edges differ from those of the whole image.
+
+            @throws std::invalid_argument for unrecognized formats, or if the
+            region doesn't overlap the image.
+        */
+    void build(
+        const TangoImageBuffer *image,  //!< Source image.
+        const PyramidRoi &roi           //!< Region to build.
+    );
+
+        //! Number of levels built.
+    int levels() const;
+
+        //! Level i, where level 0 has the resolution of the source image.
+    const PyramidLevel &level( int i ) const;
+
+        //! Settings supplied at construction.
+    const PyramidParams &params() const;
+
+private:
+        // Storage type of pixels.
+    typedef std::vector<
+        uint8_t,
+        detail::AlignedAllocator< uint8_t, BOLEO_SIMD_ALIGNMENT > >
+        storage_type;
+
+        // Buffers of 1 level.
+    struct Buffers
+    {
+        storage_type pixels;
+        std::vector< uint16_t > filtered;   // Last 5 input rows, filtered.
+        int next_row;                       // Next row to be output.
+    };
+
+        // Accepts row y of level i, passing it on to level i + 1.
+    void feed( int i, int y );
+
+    PyramidParams params_;
+    std::vector< PyramidLevel > levels_;
+    std::vector< Buffers > buffers_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_IMAGE_PYRAMID_HPP_
@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides a multi-resolution point cloud, for rendering & streaming.
+/*! @file
+
+    LodCloud accumulates TangoPointClouds into an octree, in which every node
+    holds a sparse sample of the points within it.  Each node divides its cube
+    into a grid of cells, and keeps only the first point to land in each.
+    Later points in an occupied cell pass down to a child node, whose grid is
+    twice as fine, or are dropped at the deepest level.
+
+    Drawing a node together with its ancestors therefore gives a uniform
+    density, set by the node's level.  select() chooses the nodes to draw for
+    a given viewpoint, so that distant regions are drawn coarsely, within a
+    budget of points.
+
+    The points of each node are stored contiguously, as TangoPointCloud-style
+    (x, y, z, confidence) quadruples, so a node can be uploaded or sent as
+    one block.  They're only ever appended to, and each node records the
+    version in which it last grew.  A consumer can thus fetch only the nodes
+    changed since the version it last saw, and send only their new points.
+
+    @code
+
+        LodCloud lod;
+
+            // Within the point cloud callback, given the depth camera pose:
+        lod.insert( cloud, &depth_pose );
+
+            // When streaming to a viewer:
+        std::vector< int > changed;
+        lod.changedSince( sent_version, changed );
+        for (int id: changed)
+        {
+            const LodNode node = lod.node( id );
+            send( id, node.points + 4*sent[id], node.count - sent[id] );
+            sent[id] = node.count;
+        }
+        sent_version = lod.version();
+
+            // When rendering:
+        LodView view;
+        std::copy( eye, eye + 3, view.eye );
+        view.projection = viewport_height/(2.0f*std::tan( fov_y/2.0f ));
+        lod.select( view, visible );
+
+    @endcode
+
+    @note
+    This class is not thread-safe.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_LOD_CLOUD_HPP_
+#define BOLEO_LOD_CLOUD_HPP_
+
+
+#include "boleo/pose.hpp"
+
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Settings for a LodCloud.
+struct LodParams
+{
+    float center[3] = { 0.0f, 0.0f, 0.0f }; //!< Of the root cube, in meters.
+    float size = 64.0f;         //!< Edge length of the root cube, in meters.
+    int depth = 10;             //!< Number of levels, in [1, 16].
+    int grid = 16;              //!< Cells per node edge: 4, 8, 16, 32 or 64.
+    float min_confidence = 0.0f;//!< Points below this are ignored.
+};
+
+
+    //! Cumulative insertion statistics of a LodCloud.
+struct LodStats
+{
+    int64_t clouds = 0;     //!< Number of clouds inserted.
+    int64_t points = 0;     //!< Number of points inserted.
+    int64_t stored = 0;     //!< Number of points retained in nodes.
+    double seconds = 0.0;   //!< Wall-clock time spent in insert().
+
+        //! Insertion throughput, for benchmark reporting.
+    double pointsPerSecond() const
+    {
+        return seconds > 0.0 ? double( points ) / seconds : 0.0;
+    }
+};
+
+
+    //! A viewpoint, for LodCloud::select().
+struct LodView
+{
+    float eye[3] = { 0.0f, 0.0f, 0.0f };    //!< Camera position.
+
+        //! Pixels per unit of distance, at a distance of 1: the viewport
+        //!  height divided by 2 tan( fov_y/2 ).
+    float projection = 1000.0f;
+
+        //! Nodes whose point spacing appears wider than this, in pixels, are
+        //!  refined by drawing their children.
+    float max_spacing = 2.0f;
+
+    int max_points = 1000000;   //!< Budget, over all selected nodes.
+
+        //! Optional view frustum, as up to 6 planes (a, b, c, d) such that
+        //!  a x + b y + c z + d >= 0 inside.  Nodes wholly outside are culled.
+    int plane_count = 0;
+    float planes[6][4];
+};
+
+
+    //! A view of a node of a LodCloud.
+struct LodNode
+{
+    int parent;             //!< Id of the parent, or -1 for the root.
+    int level;              //!< 0 at the root.
+    float center[3];        //!< Of the node's cube.
+    float size;             //!< Edge length of the node's cube.
+    float spacing;          //!< Edge length of its grid cells.
+    const float *points;    //!< (x, y, z, confidence) of each point.
+    int count;              //!< Number of points.
+    uint64_t version;       //!< Of the last insert() which added points.
+};
+
+
+    //! An octree of sparse point samples, built incrementally from clouds.
+class LodCloud
+{
+public:
+        //! @throws std::invalid_argument for out-of-range params.
+    explicit LodCloud( const LodParams &params = LodParams() );
+
+        //! Adds the points of cloud.  Points outside the root are ignored.
+        /*!
+            @param depth_pose must map points from the depth camera frame to
+            the map frame, such as CAMERA_DEPTH relative to START_OF_SERVICE.
+
+            @throws std::invalid_argument if depth_pose is not valid.
+        */
+    void insert(
+        const TangoPointCloud *cloud,   //!< Points, in the depth camera frame.
+        const TangoPoseData *depth_pose //!< Pose of the depth camera.
+    );
+
+        //! As above, but with a pre-computed transform.
+    void insert(
+        const TangoPointCloud *cloud,   //!< Points, in the depth camera frame.
+        const Transform &depth_to_map   //!< Depth camera to map transform.
+    );
+
+        //! Discards all points & nodes.
+        /*!
+            The version keeps counting.  See clearedVersion().
+        */
+    void clear();
+
+        //! Version of the latest insert() or clear().  Starts at 0.
+    uint64_t version() const;
+
+        //! Version of the last clear(), or 0.
+    uint64_t clearedVersion() const;
+
+        //! Number of nodes, whose ids are [0, nodeCount()).  0 is the root.
+    int nodeCount() const;
+
+        //! Describes node id.  Its points are valid until the next insert().
+    LodNode node( int id ) const;
+
+        //! Finds the nodes which gained points after version.
+        /*!
+            Parents precede their children.  Ids are appended to result.
+
+            If clearedVersion() is after version, consumers should discard
+            all nodes before applying the changes.
+        */
+    void changedSince(
+        uint64_t version,           //!< As returned by version().
+        std::vector< int > &result  //!< Receives node ids.
+    ) const;
+
+        //! Chooses the nodes to draw, from view.
+        /*!
+            Nodes are chosen coarsest (by apparent size) first, until either
+            no visible node needs refinement, or the budget is reached.  Every
+            chosen node's parent is also chosen, & precedes it.  Ids are
+            appended to result.
+        */
+    void select(
+        const LodView &view,        //!< Viewpoint.
+        std::vector< int > &result  //!< Receives node ids.
+    ) const;
+
+        //! Settings supplied at construction.
+    const LodParams &params() const;
+
+        //! Cumulative statistics of calls to insert().
+    const LodStats &stats() const;
+
+private:
+    struct Node
+    {
+        uint32_t coords[3];         // Of the cube, in units of its size.
+        int level;
+        int32_t parent;
+        int32_t children[8];        // -1 for none.
+        uint64_t version;           // When points were last added.
+        uint64_t subtree_version;   // Max over this & all descendants.
+        std::vector< float > points;
+        std::vector< uint64_t > occupied;   // 1 bit per grid cell.
+    };
+
+    int32_t addNode( int32_t parent, int level, const uint32_t *coords );
+
+    LodParams params_;
+    LodStats stats_;
+    int grid_bits_;             // log2( params_.grid )
+    uint64_t version_;
+    uint64_t cleared_version_;
+    std::vector< Node > nodes_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_LOD_CLOUD_HPP_
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides surface normal estimation on organized depth images.
+/*! @file
+
+    Rather than searching for each point's neighbors, DepthImage_normals()
+    takes them from the depth image: the normal at a pixel is the cross
+    product of the vectors between its left & right and its upper & lower
+    neighbors.  Points are reconstructed on the fly from depth, via
+    per-column & per-row factors, so the computation vectorizes across each
+    row (SSE or NEON, where available).  Rows are split across threads.
+
+    Pixels whose neighbors differ too much in depth (i.e. at discontinuities)
+    get no normal.  Missing normals are NaN, as in PCL.
+
+    @code
+
+        DepthImage depth;
+        PointCloud_toDepthImage( cloud, &intrinsics, depth );
+
+        NormalMap normals;
+        DepthImage_normals( depth, normals );
+
+            // See pcl.hpp.
+        pcl::PointCloud< pcl::PointNormal > result;
+        NormalMap_toPcl( normals, depth, result );
+
+    @endcode
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_NORMAL_MAP_HPP_
+#define BOLEO_NORMAL_MAP_HPP_
+
+
+#include "boleo/depth_image.hpp"
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Settings for DepthImage_normals().
+struct NormalParams
+{
+        //! Distance to the neighbors used, in pixels.  Larger values reduce
+        //!  noise, at the expense of detail.
+    int radius = 1;
+
+        //! Maximum depth difference between a pixel and each neighbor, as a
+        //!  fraction of the pixel's depth.  Must be in (0, 1).
+    float max_depth_change = 0.05f;
+
+    int threads = 1;    //!< Worker threads (<= 0: all cores).
+};
+
+
+    //! Per-pixel unit normals, with separate x, y & z planes.
+    /*!
+        Normals face the camera.  Pixels without a normal hold NaN.
+    */
+class NormalMap
+{
+public:
+        //! Storage type of each plane.
+    typedef DepthImage::storage_type storage_type;
+
+    NormalMap();
+
+        //! Sets the size.  Pixel values are unspecified.
+    void resize( int width, int height );
+
+    int width() const;
+    int height() const;
+
+        //! Pointers to width() values of row y, of each plane.
+    float *x( int y );
+    float *y( int y );
+    float *z( int y );
+
+    const float *x( int y ) const;
+    const float *y( int y ) const;
+    const float *z( int y ) const;
+
+private:
+    int width_;
+    int height_;
+    storage_type x_;
+    storage_type y_;
+    storage_type z_;
+};
+
+
+    //! Estimates a normal for each pixel of depth.
+    /*!
+        result is resized to match depth.
+
+        @throws std::invalid_argument for out-of-range params.
+    */
+void DepthImage_normals(
+    const DepthImage &depth,                        //!< Input image.
+    NormalMap &result,                              //!< Output normals.
+    const NormalParams &params = NormalParams()     //!< Settings.
+);
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_NORMAL_MAP_HPP_
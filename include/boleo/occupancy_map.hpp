@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides an incrementally-updated occupancy octree, fed by TangoPointCloud.
+/*! @file
+
+    OccupancyMap ingests each TangoPointCloud, together with the pose of the
+    depth camera, by casting a ray from the camera to every point.  Voxels
+    along each ray are updated as free, while the voxel containing the point
+    is updated as occupied.
+
+    Rays are traced in parallel and the resulting voxel keys are merged, so
+    that each voxel is updated at most once per cloud.  Keys are Morton codes,
+    which are applied in sorted order, so that successive updates tend to
+    touch neighbouring nodes.  Nodes are allocated in blocks of 8 siblings,
+    from a single pool which is retained by clear().
+
+    @code
+
+        OccupancyMap map;
+
+            // Within the point cloud callback, given the depth camera pose:
+        map.insert( cloud, &depth_pose );
+
+            // Elsewhere, consume only the voxels which changed.
+        for (OccupancyKey key: map.takeChanges())
+        {
+            float center[3];
+            map.keyToCoord( key, center );
+            redraw( center, map.isOccupied( key ) );
+        }
+
+    @endcode
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_OCCUPANCY_MAP_HPP_
+#define BOLEO_OCCUPANCY_MAP_HPP_
+
+
+#include "boleo/pose.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace detail
+{
+    class WorkerPool;
+}
+
+
+    //! Identifies a leaf voxel, as the Morton code of its integer coordinates.
+typedef uint64_t OccupancyKey;
+
+
+    //! Settings for an OccupancyMap.
+    /*!
+        Occupancy is tracked as log-odds, clamped to [clamp_min, clamp_max].
+    */
+struct OccupancyParams
+{
+    float resolution = 0.05f;   //!< Edge length of leaf voxels, in meters.
+    int depth = 16;             //!< Tree depth, in [1, 16].
+    float max_range = 4.0f;     //!< Rays are truncated beyond this range.
+    float log_odds_hit = 0.85f; //!< Update applied to occupied voxels.
+    float log_odds_miss = -0.4f;//!< Update applied to free voxels.
+    float clamp_min = -2.0f;    //!< Lower bound of voxel log-odds.
+    float clamp_max = 3.5f;     //!< Upper bound of voxel log-odds.
+    float occupied = 0.0f;      //!< Voxels above this log-odds are occupied.
+    int threads = 0;            //!< Ray casting threads (<= 0: all cores).
+};
+
+
+    //! Cumulative insertion statistics of an OccupancyMap.
+struct OccupancyStats
+{
+    int64_t clouds = 0;         //!< Number of clouds inserted.
+    int64_t points = 0;         //!< Number of points inserted.
+    int64_t voxel_updates = 0;  //!< Number of distinct voxel updates.
+    double seconds = 0.0;       //!< Wall-clock time spent in insert().
+
+        //! Insertion throughput, for benchmark reporting.
+    double pointsPerSecond() const
+    {
+        return seconds > 0.0 ? double( points ) / seconds : 0.0;
+    }
+};
+
+
+    //! An occupancy octree, built incrementally from TangoPointClouds.
+class OccupancyMap
+{
+public:
+        //! Starts the ray casting threads, which persist until destroyed.
+    explicit OccupancyMap( const OccupancyParams &params = OccupancyParams() );
+
+    OccupancyMap( const OccupancyMap & ) = delete;
+    OccupancyMap &operator=( const OccupancyMap & ) = delete;
+
+    ~OccupancyMap();
+
+        //! Casts rays from the sensor origin to each point of cloud.
+        /*!
+            @param depth_pose must map points from the depth camera frame to
+            the map frame, such as CAMERA_DEPTH relative to START_OF_SERVICE.
+
+            @throws std::invalid_argument if depth_pose is not valid.
+        */
+    void insert(
+        const TangoPointCloud *cloud,   //!< Points, in the depth camera frame.
+        const TangoPoseData *depth_pose //!< Pose of the depth camera.
+    );
+
+        //! As above, but with a pre-computed transform.
+    void insert(
+        const TangoPointCloud *cloud,   //!< Points, in the depth camera frame.
+        const Transform &depth_to_map   //!< Depth camera to map transform.
+    );
+
+        //! Discards all voxels & changes, retaining allocated memory.
+    void clear();
+
+        //! Returns the key of the leaf voxel containing the point.
+        /*!
+            @returns false, if the point lies outside the map's extent.
+        */
+    bool coordToKey( const float *xyz, OccupancyKey &key ) const;
+
+        //! Writes the coordinates of the center of a leaf voxel.
+    void keyToCoord( OccupancyKey key, float *xyz ) const;
+
+        //! Returns the log-odds of a leaf voxel, or 0 if it's unknown.
+    float logOdds( OccupancyKey key ) const;
+
+        //! Returns whether the voxel has been observed.
+    bool isKnown( OccupancyKey key ) const;
+
+        //! Returns whether the voxel is known & its log-odds exceeds threshold.
+    bool isOccupied( OccupancyKey key ) const;
+
+        //! Returns the leaf voxels modified since the last call, sorted.
+    std::vector< OccupancyKey > takeChanges();
+
+        //! Settings supplied at construction.
+    const OccupancyParams &params() const;
+
+        //! Cumulative statistics of calls to insert().
+    const OccupancyStats &stats() const;
+
+        //! Number of allocated tree nodes.
+    int nodeCount() const;
+
+private:
+        // Children of a node occupy 8 consecutive entries of nodes_.
+    struct Node
+    {
+        float log_odds;     // Max over children, for interior nodes.
+        int32_t children;   // Index of first child, or -1 for none.
+    };
+
+    int findLeaf( OccupancyKey key ) const;
+    bool update( OccupancyKey key, float delta );
+    int32_t allocateChildren( float log_odds );
+
+    OccupancyParams params_;
+    OccupancyStats stats_;
+    std::vector< Node > nodes_;
+    std::vector< OccupancyKey > changes_;
+
+        // Ray casting threads & buffers, retained between calls to insert().
+    std::unique_ptr< detail::WorkerPool > pool_;
+    std::vector< std::vector< OccupancyKey > > free_keys_;
+    std::vector< std::vector< OccupancyKey > > hit_keys_;
+    std::vector< OccupancyKey > merged_free_;
+    std::vector< OccupancyKey > merged_hit_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_OCCUPANCY_MAP_HPP_
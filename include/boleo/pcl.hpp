@@ -18,6 +18,11 @@
 #define BOLEO_PCL_HPP_
 
 
+#include "boleo/blob.hpp"
+#include "boleo/grid_index.hpp"
+#include "boleo/normal_map.hpp"
+#include "boleo/pipeline.hpp"
+#include "boleo/point_cloud_soa.hpp"
 #include "boleo/detail/common.hpp"
 
 extern "C"
@@ -27,6 +32,11 @@ extern "C"
 
 #include "pcl/point_types.h"
 #include "pcl/point_cloud.h"
+#include "pcl/PCLPointCloud2.h"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
 
 
     //! Namespace for Boleo.
@@ -76,6 +86,347 @@ pcl::PointCloud< point_type > PointCloud_toPcl(
 }
 
 
+    //! Creates a pcl::PointCloud< T > by running a TangoPointCloud through a
+    //!  pipeline of fused stages.  See pipeline.hpp.
+    /*!
+        The point type of the result is the output type of the pipeline's
+        final stage, typically ConvertTo< T >().
+    */
+template<
+    typename stages_type    //!< Type of the pipeline.
+>
+pcl::PointCloud<
+    typename stages_type::template output< PipelinePoint >::type
+> PointCloud_toPcl(
+    const TangoPointCloud *cloud,                   //!< Input cloud.
+    const PipelineStage< stages_type > &pipeline    //!< Stages to apply.
+)
+{
+    typedef typename stages_type::template output< PipelinePoint >::type
+        point_type;
+
+    pcl::PointCloud< point_type > result;
+    result.points.reserve( cloud->num_points );
+
+    auto sink = [&result]( const point_type &point )
+    {
+        result.points.push_back( point );
+    };
+
+    PointCloud_forEach( cloud, pipeline, sink );
+
+    result.width = uint32_t( result.points.size() );
+    result.height = 1;
+    return result;
+}
+
+
+    //! Creates a pcl::PointCloud< T > from a TangoPointCloud, while building
+    //!  a GridIndex of it, in the same pass.  See grid_index.hpp.
+    /*!
+        Point i of the result corresponds to index i of the GridIndex.
+    */
+template<
+    typename point_type,    //!< Type of point cloud to create.
+    typename converter_type //!< Type of point transfer function.
+>
+pcl::PointCloud< point_type > PointCloud_toPcl(
+    const TangoPointCloud *cloud,       //!< Input cloud.
+    const converter_type &converter,    //!< Point transfer function instance.
+    GridIndex &index                    //!< Rebuilt from cloud.
+)
+{
+    pcl::PointCloud< point_type > result;
+    result.resize( cloud->num_points );
+
+    index.begin( int( cloud->num_points ) );
+    for (uint32_t i = 0; i != cloud->num_points; ++i)
+    {
+        const PointType & BOLEO_RESTRICT tango_point = cloud->points[i];
+        result[i] = converter( tango_point );
+        index.add( int( i ), tango_point[0], tango_point[1], tango_point[2] );
+    }
+
+    index.finish();
+    return result;
+}
+
+
+    //! Creates a pcl::PointCloud< T > from a PointCloudSoA.
+    /*!
+        Each point is gathered into TangoPoint form, so that the same
+        converters can be used as with PointCloud_toPcl().
+    */
+template<
+    typename point_type,    //!< Type of point cloud to create.
+    typename converter_type //!< Type of point transfer function.
+>
+pcl::PointCloud< point_type > PointCloudSoA_toPcl(
+    const PointCloudSoA &cloud,     //!< Input cloud.
+    const converter_type &converter //!< Point transfer function instance.
+)
+{
+    const int n = cloud.size();
+    pcl::PointCloud< point_type > result;
+    result.resize( n );
+
+    const float * BOLEO_RESTRICT x = cloud.x();
+    const float * BOLEO_RESTRICT y = cloud.y();
+    const float * BOLEO_RESTRICT z = cloud.z();
+    const float * BOLEO_RESTRICT c = cloud.confidence();
+
+    for (int i = 0; i != n; ++i)
+    {
+        float tango_point[4] = { x[i], y[i], z[i], c[i] };
+        result[i] = converter( tango_point );
+    }
+
+    return result;
+}
+
+
+namespace detail
+{
+
+        // Confidence of PCL points without an equivalent field.
+    template< typename point_type >
+    float PclConfidence( const point_type &, float default_confidence )
+    {
+        return default_confidence;
+    }
+
+    inline float PclConfidence( const pcl::InterestPoint &point, float )
+    {
+        return point.strength;
+    }
+
+    inline float PclConfidence( const pcl::PointXYZI &point, float )
+    {
+        return point.intensity;
+    }
+
+}
+
+
+    //! Fills a PointCloudSoA from a pcl::PointCloud< T >.
+    /*!
+        Confidence is taken from pcl::InterestPoint::strength or
+        pcl::PointXYZI::intensity.  Other point types receive
+        default_confidence.
+    */
+template<
+    typename point_type     //!< Type of input point cloud.
+>
+void PointCloudSoA_fromPcl(
+    const pcl::PointCloud< point_type > &cloud, //!< Input cloud.
+    PointCloudSoA &result,                      //!< Output cloud.
+    float default_confidence = 1.0f             //!< See description.
+)
+{
+    const int n = int( cloud.size() );
+    result.resize( n );
+
+    float * BOLEO_RESTRICT x = result.x();
+    float * BOLEO_RESTRICT y = result.y();
+    float * BOLEO_RESTRICT z = result.z();
+    float * BOLEO_RESTRICT c = result.confidence();
+
+    for (int i = 0; i != n; ++i)
+    {
+        const point_type &point = cloud[i];
+        x[i] = point.x;
+        y[i] = point.y;
+        z[i] = point.z;
+        c[i] = detail::PclConfidence( point, default_confidence );
+    }
+}
+
+
+    //! Fills an organized pcl::PointCloud< pcl::Normal > from a NormalMap.
+    //!  See normal_map.hpp.
+    /*!
+        Missing normals are NaN.  Curvature is not estimated, and is set to 0.
+    */
+inline void NormalMap_toPcl(
+    const NormalMap &normals,               //!< Input normals.
+    pcl::PointCloud< pcl::Normal > &result  //!< Output cloud.
+)
+{
+    const int width = normals.width();
+    const int height = normals.height();
+    result.resize( size_t( width )*height );
+    result.width = uint32_t( width );
+    result.height = uint32_t( height );
+    result.is_dense = false;
+
+    for (int y = 0; y != height; ++y)
+    {
+        const float * BOLEO_RESTRICT nx = normals.x( y );
+        const float * BOLEO_RESTRICT ny = normals.y( y );
+        const float * BOLEO_RESTRICT nz = normals.z( y );
+        pcl::Normal *out = &result[ size_t( y )*width ];
+
+        for (int x = 0; x != width; ++x)
+        {
+            out[x].normal_x = nx[x];
+            out[x].normal_y = ny[x];
+            out[x].normal_z = nz[x];
+            out[x].curvature = 0.0f;
+        }
+    }
+}
+
+
+    //! Fills an organized pcl::PointCloud< pcl::PointNormal > from a
+    //!  NormalMap & the DepthImage it was estimated from.
+    /*!
+        Pixels without depth yield NaN points.  Missing normals are NaN.
+        Curvature is not estimated, and is set to 0.
+    */
+inline void NormalMap_toPcl(
+    const NormalMap &normals,                       //!< Input normals.
+    const DepthImage &depth,                        //!< Input points.
+    pcl::PointCloud< pcl::PointNormal > &result     //!< Output cloud.
+)
+{
+    const int width = normals.width();
+    const int height = normals.height();
+    result.resize( size_t( width )*height );
+    result.width = uint32_t( width );
+    result.height = uint32_t( height );
+    result.is_dense = false;
+
+    const PinholeCamera &camera = depth.camera();
+    const float inverse_fx = 1.0f/camera.fx;
+    const float inverse_fy = 1.0f/camera.fy;
+    const float nan = std::numeric_limits< float >::quiet_NaN();
+
+    for (int y = 0; y != height; ++y)
+    {
+        const float * BOLEO_RESTRICT z = depth.row( y );
+        const float * BOLEO_RESTRICT nx = normals.x( y );
+        const float * BOLEO_RESTRICT ny = normals.y( y );
+        const float * BOLEO_RESTRICT nz = normals.z( y );
+        pcl::PointNormal *out = &result[ size_t( y )*width ];
+        const float ky = (float( y ) - camera.cy)*inverse_fy;
+
+        for (int x = 0; x != width; ++x)
+        {
+            const float kx = (float( x ) - camera.cx)*inverse_fx;
+            const bool valid = z[x] > 0.0f;
+            out[x].x = valid ? kx*z[x] : nan;
+            out[x].y = valid ? ky*z[x] : nan;
+            out[x].z = valid ? z[x] : nan;
+            out[x].normal_x = nx[x];
+            out[x].normal_y = ny[x];
+            out[x].normal_z = nz[x];
+            out[x].curvature = 0.0f;
+        }
+    }
+}
+
+
+namespace detail
+{
+
+        // Fills all of a PCLPointCloud2 except its data.
+    inline void PclPointCloud2_describe(
+        const TangoPointCloud *cloud,
+        const BlobLayout &layout,
+        const char *confidence_name,
+        pcl::PCLPointCloud2 &result )
+    {
+        static const char *const channel_names[3] = { "x", "y", "z" };
+
+        result.header.stamp = uint64_t( cloud->timestamp * 1.0e6 );
+        result.height = 1;
+        result.width = cloud->num_points;
+        result.is_bigendian = false;
+        result.point_step = layout.point_step;
+        result.row_step = layout.point_step * cloud->num_points;
+        result.is_dense = true;
+
+        result.fields.clear();
+        for (const BlobField &field: layout.fields)
+        {
+            const int size = BlobDatatype_size( field.datatype );
+            for (int c = 0; c != field.count; ++c)
+            {
+                const int channel = field.channel + c;
+
+                pcl::PCLPointField pcl_field;
+                pcl_field.name = channel < channel_confidence
+                    ? channel_names[channel] : confidence_name;
+                pcl_field.offset = field.offset + c*size;
+                pcl_field.datatype = uint8_t( field.datatype );
+                pcl_field.count = 1;
+                result.fields.push_back( pcl_field );
+            }
+        }
+    }
+
+}
+
+
+    //! Fills a pcl::PCLPointCloud2 directly from a TangoPointCloud, per a
+    //!  compile-time layout.  See blob.hpp.
+    /*!
+        This avoids the intermediate pcl::PointCloud< T > & per-field
+        reflection of pcl::toPCLPointCloud2().  The existing capacity of
+        result.data is reused.
+    */
+template<
+    typename layout_type    //!< BlobXyz or BlobXyzi.
+>
+void PointCloud_toPclPointCloud2(
+    const TangoPointCloud *cloud,   //!< Input cloud.
+    pcl::PCLPointCloud2 &result,    //!< Output cloud.
+    const char *confidence_name = "intensity"   //!< Field name for confidence.
+)
+{
+    detail::PclPointCloud2_describe(
+        cloud, layout_type::layout(), confidence_name, result );
+
+    result.data.resize( result.row_step );
+    if (!result.data.empty())
+    {
+        PointCloud_toBlob< layout_type >( cloud, result.data.data() );
+    }
+}
+
+
+    //! Fills a pcl::PCLPointCloud2 directly from a TangoPointCloud, per a
+    //!  runtime layout.  See blob.hpp.
+    /*!
+        @throws std::invalid_argument if the layout is invalid (see
+        BlobLayout_validate()), or the data would exceed PCL's 4 GiB limit.
+        result is then left unmodified.
+    */
+inline void PointCloud_toPclPointCloud2(
+    const TangoPointCloud *cloud,   //!< Input cloud.
+    const BlobLayout &layout,       //!< Description of each point.
+    pcl::PCLPointCloud2 &result,    //!< Output cloud.
+    const char *confidence_name = "intensity"   //!< Field name for confidence.
+)
+{
+    BlobLayout_validate( layout );
+    const uint64_t row_step = uint64_t( layout.point_step )*cloud->num_points;
+    if (row_step > std::numeric_limits< uint32_t >::max())
+    {
+        throw std::invalid_argument( "PCLPointCloud2 row_step exceeds 32 bits" );
+    }
+
+    detail::PclPointCloud2_describe( cloud, layout, confidence_name, result );
+
+        // Zero-filled, so that any padding bytes are deterministic.
+    result.data.assign( result.row_step, 0 );
+    if (!result.data.empty())
+    {
+        PointCloud_toBlob( cloud, layout, result.data.data() );
+    }
+}
+
+
 } // namespace boleo
 
 
@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides RANSAC plane extraction, directly from TangoPointCloud.
+/*! @file
+
+    PlaneExtractor finds the dominant planes of a cloud (e.g. floor, walls
+    & tables), one after another.  Each plane is found by RANSAC:
+
+    - Hypotheses are evaluated concurrently, by several threads.
+    - Inliers are counted over structure-of-arrays points, 4 at a time
+      (SSE or NEON, where available).  A hypothesis is abandoned as soon as
+      it can no longer beat the best so far.
+    - The number of hypotheses is adapted to the best inlier ratio found,
+      so that easy clouds terminate early.
+    - The winning plane is refit to its inliers, by least squares.
+
+    After each plane, its inliers are removed by compacting the remaining
+    points in place, so subsequent planes search fewer points.  Buffers are
+    reused from one cloud to the next.
+
+    @code
+
+        PlaneParams params;
+        params.max_planes = 4;
+        PlaneExtractor extractor( params );
+
+        const int n = extractor.extract( cloud );
+        for (int i = 0; i < n; ++i)
+        {
+            const Plane &plane = extractor.plane( i );
+            const int *indices = extractor.inliers( i );
+            ...
+        }
+
+    @endcode
+
+    @note
+    This class is not thread-safe, except that extract() uses threads
+    internally.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_PLANE_EXTRACTOR_HPP_
+#define BOLEO_PLANE_EXTRACTOR_HPP_
+
+
+#include "boleo/point_cloud_soa.hpp"
+
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Settings for PlaneExtractor.
+struct PlaneParams
+{
+    int max_planes = 3;             //!< Maximum planes per cloud.
+    float distance = 0.02f;         //!< Inlier threshold, in meters.
+    int min_inliers = 500;          //!< Smaller planes end the search.
+    int max_hypotheses = 1000;      //!< Per plane.
+    float probability = 0.99f;      //!< Of finding the best plane.
+    float min_confidence = 0.0f;    //!< Points below this are ignored.
+    uint32_t seed = 1;              //!< Of the hypothesis sampling.
+
+        //! Worker threads (<= 0: all cores).  Results are reproducible for a
+        //!  given seed only with 1 thread, since with more, the number of
+        //!  hypotheses evaluated depends on timing.
+    int threads = 1;
+};
+
+
+    //! A plane extracted by PlaneExtractor.
+struct Plane
+{
+        //! Coefficients (a, b, c, d), such that a x + b y + c z + d = 0.
+        //!  (a, b, c) has unit length & faces the sensor, so that d >= 0.
+    float coefficients[4];
+
+    int inliers;        //!< Number of inlier points.
+    int hypotheses;     //!< Number evaluated, in finding this plane.
+};
+
+
+    //! Cumulative statistics of a PlaneExtractor.
+struct PlaneStats
+{
+    int64_t clouds = 0;         //!< Number of clouds processed.
+    int64_t points = 0;         //!< Number of points processed.
+    int64_t hypotheses = 0;     //!< Number of hypotheses evaluated.
+    double seconds = 0.0;       //!< Wall-clock time spent in extract().
+
+        //! Throughput, for benchmark reporting.
+    double pointsPerSecond() const
+    {
+        return seconds > 0.0 ? double( points ) / seconds : 0.0;
+    }
+};
+
+
+    //! Iterative, multithreaded RANSAC plane extraction.
+class PlaneExtractor
+{
+public:
+        //! @throws std::invalid_argument for out-of-range params.
+    explicit PlaneExtractor( const PlaneParams &params = PlaneParams() );
+
+        //! Finds up to params().max_planes planes in cloud, largest first.
+        /*!
+            Replaces the results of any previous call.
+
+            @returns the number of planes found.
+        */
+    int extract(
+        const TangoPointCloud *cloud    //!< Input cloud.
+    );
+
+        //! Number of planes found by the last extract().
+    int size() const;
+
+        //! Plane i, of the last extract().
+    const Plane &plane( int i ) const;
+
+        //! Indices into the cloud's points of the inliers of plane i.
+        /*!
+            There are plane( i ).inliers of them.  Each point belongs to at
+            most 1 plane.
+        */
+    const int *inliers( int i ) const;
+
+        //! Indices of the points which belong to no plane.
+        /*!
+            Points excluded by min_confidence aren't included.
+        */
+    const std::vector< int > &remaining() const;
+
+        //! Settings supplied at construction.
+    const PlaneParams &params() const;
+
+        //! Statistics, since construction.
+    const PlaneStats &stats() const;
+
+private:
+        // Moves the inliers of plane from remaining_ to inliers_.
+    int partition( const float *coefficients );
+
+    PlaneParams params_;
+    PlaneStats stats_;
+    PointCloudSoA points_;          // Parallel to remaining_.
+    std::vector< int > remaining_;
+    std::vector< int > inliers_;    // Of all planes, in order.
+    std::vector< int > offsets_;    // Into inliers_, per plane.
+    std::vector< Plane > planes_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_PLANE_EXTRACTOR_HPP_
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides a structure-of-arrays point cloud container.
+/*! @file
+
+    TangoPointCloud::points and pcl::PointCloud< T > both interleave the
+    channels of each point.  Stages which only touch some channels, or which
+    want to process several points per instruction, do better with each
+    channel stored contiguously.  PointCloudSoA keeps x, y, z & confidence in
+    separate arrays, each aligned to BOLEO_SIMD_ALIGNMENT.
+
+    @code
+
+        PointCloudSoA soa;      // Reuse across frames, to avoid reallocation.
+        PointCloud_toSoA( cloud, soa );
+
+        float min[3], max[3];
+        PointCloudSoA_bounds( soa, min, max );
+
+    @endcode
+
+    Conversion to & from pcl::PointCloud< T > is provided by pcl.hpp.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_POINT_CLOUD_SOA_HPP_
+#define BOLEO_POINT_CLOUD_SOA_HPP_
+
+
+#include "boleo/detail/aligned.hpp"
+#include "boleo/detail/features.hpp"
+
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! A point cloud with separate, aligned x/y/z/confidence arrays.
+class PointCloudSoA
+{
+public:
+        //! Storage type of each channel.
+    typedef std::vector<
+        float,
+        detail::AlignedAllocator< float, BOLEO_SIMD_ALIGNMENT > > channel_type;
+
+    PointCloudSoA();
+
+        //! Creates a cloud of size points, with unspecified values.
+    explicit PointCloudSoA( int size );
+
+        //! Changes the number of points, retaining existing capacity.
+    void resize( int size );
+
+        //! Ensures capacity for at least size points.
+    void reserve( int size );
+
+        //! Number of points.
+    int size() const;
+
+    bool empty() const;
+
+        //! Appends a single point.
+    void push_back( float x, float y, float z, float confidence );
+
+        //! Channel accessors.  Each points to size() contiguous values.
+    float *x();
+    float *y();
+    float *z();
+    float *confidence();
+
+    const float *x() const;
+    const float *y() const;
+    const float *z() const;
+    const float *confidence() const;
+
+private:
+    channel_type x_;
+    channel_type y_;
+    channel_type z_;
+    channel_type confidence_;
+};
+
+
+    //! Transposes TangoPointCloud::points into a PointCloudSoA.
+    /*!
+        result is resized to match cloud.  Uses SSE or NEON, if available.
+    */
+void PointCloud_toSoA(
+    const TangoPointCloud *cloud,   //!< Input cloud.
+    PointCloudSoA &result           //!< Output cloud.
+);
+
+
+    //! Computes the axis-aligned bounding box of a non-empty cloud.
+void PointCloudSoA_bounds(
+    const PointCloudSoA &cloud, //!< Input cloud.
+    float *min,                 //!< Receives the minimum (x, y, z).
+    float *max                  //!< Receives the maximum (x, y, z).
+);
+
+
+    //! Computes the mean (x, y, z) of a non-empty cloud.
+void PointCloudSoA_centroid(
+    const PointCloudSoA &cloud, //!< Input cloud.
+    float *centroid             //!< Receives the mean (x, y, z).
+);
+
+
+    //! Computes the squared distance from each point to a reference point.
+    /*!
+        result is resized to match cloud.
+    */
+void PointCloudSoA_distanceSq(
+    const PointCloudSoA &cloud,         //!< Input cloud.
+    const float *reference,             //!< Reference (x, y, z).
+    PointCloudSoA::channel_type &result //!< Receives 1 value per point.
+);
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_POINT_CLOUD_SOA_HPP_
@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides a rigid transform type, for applying TangoPoseData to points.
+/*! @file
+
+    TangoPoseData stores orientation as a double-precision quaternion, which
+    is an inconvenient form for transforming large numbers of points.
+    Transform holds the equivalent single-precision rotation matrix and
+    translation, so that it can be applied within tight loops.
+
+    @code
+
+        Transform t = Pose_toTransform( pose );
+        for (uint32_t i = 0; i != cloud->num_points; ++i)
+        {
+            float world[3];
+            Transform_apply( t, cloud->points[i], world );
+        }
+
+    @endcode
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_POSE_HPP_
+#define BOLEO_POSE_HPP_
+
+
+#include "boleo/detail/common.hpp"
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! A rigid transform, in single precision.
+struct Transform
+{
+    float rotation[3][3];   //!< Row-major rotation matrix.
+    float translation[3];   //!< Applied after rotation.
+};
+
+
+    //! Returns a Transform which leaves points unchanged.
+inline Transform IdentityTransform()
+{
+    Transform result = {
+        { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+        { 0.0f, 0.0f, 0.0f } };
+
+    return result;
+}
+
+
+    //! Converts a TangoPoseData into the equivalent Transform.
+    /*!
+        The result maps points from the pose's target frame into its base
+        frame.  No check is made of TangoPoseData::status_code.
+    */
+inline Transform Pose_toTransform(
+    const TangoPoseData *pose   //!< Pose to convert.
+)
+{
+        // TangoPoseData::orientation is ordered (x, y, z, w).
+    const double x = pose->orientation[0];
+    const double y = pose->orientation[1];
+    const double z = pose->orientation[2];
+    const double w = pose->orientation[3];
+
+    Transform result;
+    result.rotation[0][0] = float( 1.0 - 2.0*(y*y + z*z) );
+    result.rotation[0][1] = float( 2.0*(x*y - z*w) );
+    result.rotation[0][2] = float( 2.0*(x*z + y*w) );
+    result.rotation[1][0] = float( 2.0*(x*y + z*w) );
+    result.rotation[1][1] = float( 1.0 - 2.0*(x*x + z*z) );
+    result.rotation[1][2] = float( 2.0*(y*z - x*w) );
+    result.rotation[2][0] = float( 2.0*(x*z - y*w) );
+    result.rotation[2][1] = float( 2.0*(y*z + x*w) );
+    result.rotation[2][2] = float( 1.0 - 2.0*(x*x + y*y) );
+
+    for (int i = 0; i != 3; ++i)
+    {
+        result.translation[i] = float( pose->translation[i] );
+    }
+
+    return result;
+}
+
+
+    //! Returns the Transform equivalent to applying b, then a.
+inline Transform Transform_compose(
+    const Transform &a, //!< Outer transform.
+    const Transform &b  //!< Inner transform.
+)
+{
+    Transform result;
+    for (int r = 0; r != 3; ++r)
+    {
+        for (int c = 0; c != 3; ++c)
+        {
+            result.rotation[r][c] =
+                a.rotation[r][0]*b.rotation[0][c]
+                + a.rotation[r][1]*b.rotation[1][c]
+                + a.rotation[r][2]*b.rotation[2][c];
+        }
+
+        result.translation[r] = a.translation[r]
+            + a.rotation[r][0]*b.translation[0]
+            + a.rotation[r][1]*b.translation[1]
+            + a.rotation[r][2]*b.translation[2];
+    }
+
+    return result;
+}
+
+
+    //! Returns the inverse of a rigid Transform.
+inline Transform Transform_inverse(
+    const Transform &t  //!< Transform to invert.
+)
+{
+    Transform result;
+    for (int r = 0; r != 3; ++r)
+    {
+        for (int c = 0; c != 3; ++c)
+        {
+            result.rotation[r][c] = t.rotation[c][r];
+        }
+    }
+
+    for (int r = 0; r != 3; ++r)
+    {
+        result.translation[r] = -(
+            result.rotation[r][0]*t.translation[0]
+            + result.rotation[r][1]*t.translation[1]
+            + result.rotation[r][2]*t.translation[2]);
+    }
+
+    return result;
+}
+
+
+    //! Applies a Transform to the first 3 elements of in, writing to out.
+    /*!
+        Compatible with the elements of TangoPointCloud::points.  in and out
+        must not overlap.
+    */
+inline void Transform_apply(
+    const Transform &t,                 //!< Transform to apply.
+    const float * BOLEO_RESTRICT in,    //!< Input point (x, y, z).
+    float * BOLEO_RESTRICT out          //!< Output point (x, y, z).
+)
+{
+    for (int r = 0; r != 3; ++r)
+    {
+        out[r] = t.rotation[r][0]*in[0]
+            + t.rotation[r][1]*in[1]
+            + t.rotation[r][2]*in[2]
+            + t.translation[r];
+    }
+}
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_POSE_HPP_
@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides frame-to-frame ICP registration of Tango point clouds.
+/*! @file
+
+    IcpRegistration refines the rigid transform between two point clouds,
+    starting from a guess (typically, the relative pose reported by Tango).
+    It minimizes point-to-plane error, using:
+
+    - Projective data association: each cloud is projected into a depth
+      image (see depth_image.hpp), and each source point is matched with
+      whichever target point it projects onto.  No search is required.
+    - A coarse-to-fine pyramid, built by repeatedly halving both images.
+    - SIMD accumulation of the 6x6 normal equations, split across threads
+      by rows.  The threads persist from one iteration & call to the next.
+
+    @code
+
+        IcpRegistration icp( &depth_intrinsics );
+
+            // Relative pose of the previous cloud's frame, in the current's.
+        Transform guess = Transform_compose(
+            Transform_inverse( Pose_toTransform( current_pose ) ),
+            Pose_toTransform( previous_pose ) );
+
+        IcpResult result = icp.align( previous, current, guess );
+        if (result.converged) guess = result.transform;
+
+    @endcode
+
+    @note
+    This class is not thread-safe, since it reuses its image pyramids from
+    one call to the next.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_REGISTRATION_HPP_
+#define BOLEO_REGISTRATION_HPP_
+
+
+#include "boleo/depth_image.hpp"
+#include "boleo/pose.hpp"
+
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#   include "tango_client_api.h"
+}
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace detail
+{
+    class WorkerPool;
+}
+
+
+    //! Settings for IcpRegistration.
+struct IcpParams
+{
+        //! Maximum iterations per pyramid level, coarsest first.  The number
+        //!  of levels is the size of this vector.
+    std::vector< int > iterations = { 10, 5, 4 };
+
+    int divisor = 1;                    //!< Scale-down of the finest level.
+    float max_distance = 0.1f;          //!< Correspondence gate, in meters.
+    float max_normal_angle = 0.5f;      //!< Correspondence gate, in radians.
+    float translation_epsilon = 1e-4f;  //!< Convergence threshold, in meters.
+    float rotation_epsilon = 1e-4f;     //!< Convergence threshold, in radians.
+    int min_correspondences = 64;       //!< Fewer than this fails a level.
+    int threads = 1;                    //!< Worker threads (<= 0: all cores).
+};
+
+
+    //! Outcome of IcpRegistration::align().
+struct IcpResult
+{
+    Transform transform;    //!< Maps source points into the target frame.
+    bool converged;         //!< Whether the finest level converged.
+    int iterations;         //!< Total, over all levels.
+    int correspondences;    //!< In the final iteration.
+    float rms_error;        //!< Point-to-plane, in the final iteration.
+    double seconds;         //!< Time spent, including pyramid construction.
+
+        //! Throughput, for comparison across devices & settings.
+    double iterationsPerMillisecond() const
+    {
+        return seconds > 0.0 ? iterations/(seconds*1e3) : 0.0;
+    }
+};
+
+
+    //! Point-to-plane ICP, with projective data association.
+class IcpRegistration
+{
+public:
+        //! Starts the worker threads, which persist until destroyed.
+        /*!
+            @throws std::invalid_argument if params.iterations is empty.
+        */
+    explicit IcpRegistration(
+        const TangoCameraIntrinsics *depth_intrinsics,  //!< Depth camera.
+        const IcpParams &params = IcpParams()
+    );
+
+    IcpRegistration( const IcpRegistration & ) = delete;
+    IcpRegistration &operator=( const IcpRegistration & ) = delete;
+
+    ~IcpRegistration();
+
+        //! Finds the transform mapping source into target's frame.
+        /*!
+            If a level fails (due to too few correspondences, or a singular
+            system), the estimate from the preceding level is retained.
+        */
+    IcpResult align(
+        const TangoPointCloud *source,  //!< Cloud to move.
+        const TangoPointCloud *target,  //!< Cloud to match.
+        const Transform &guess          //!< Initial estimate.
+    );
+
+        //! As above, with the guess given as a pose.  See Pose_toTransform().
+    IcpResult align(
+        const TangoPointCloud *source,  //!< Cloud to move.
+        const TangoPointCloud *target,  //!< Cloud to match.
+        const TangoPoseData *guess      //!< Source frame, w.r.t. target's.
+    );
+
+        //! Settings supplied at construction.
+    const IcpParams &params() const;
+
+private:
+        // One level of a pyramid.
+    struct Level
+    {
+        DepthImage depth;
+        std::vector< float > vertices;  // 3 per pixel.  z = 0 if invalid.
+        std::vector< float > normals;   // 3 per pixel.  0 if invalid.
+    };
+
+    void buildPyramid(
+        const TangoPointCloud *cloud,
+        std::vector< Level > &pyramid );
+
+    TangoCameraIntrinsics intrinsics_;
+    IcpParams params_;
+    std::unique_ptr< detail::WorkerPool > pool_;
+    std::vector< Level > source_;
+    std::vector< Level > target_;
+};
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_REGISTRATION_HPP_
@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Provides a work-stealing task scheduler, with per-task deadlines.
+/*! @file
+
+    Rather than processing frames on the thread which delivered them, submit
+    the work to a TaskScheduler.  Each worker has its own deque: it takes its
+    own tasks newest-first and, when idle, steals others' oldest-first.
+
+    A task may carry a deadline, by which it must start.  Tasks which can't
+    start in time are dropped, rather than run late.  Per-frame tasks can be
+    grouped into a TaskStream, in which case a newly submitted frame
+    supersedes any of the stream's frames still queued.  So, stale frames
+    don't queue up behind new ones.
+
+    @code
+
+        SchedulerParams params;
+        params.cpus = FastestCpus();    // Keep off the LITTLE cores.
+        TaskScheduler scheduler( params );
+        TaskStream clouds;
+
+            // In the Tango callback:
+        CloudFramePtr frame = ...;
+        auto deadline = TaskScheduler::clock_type::now()
+            + std::chrono::milliseconds( 200 );
+
+        scheduler.submit( clouds, [frame] { Process( *frame ); }, deadline );
+
+            // Periodically:
+        SchedulerStats stats = scheduler.stats();
+        LOGI( "Missed deadlines: %lld", stats.deadlineMisses() );
+
+    @endcode
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BOLEO_TASK_SCHEDULER_HPP_
+#define BOLEO_TASK_SCHEDULER_HPP_
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+    //! Settings for TaskScheduler.
+struct SchedulerParams
+{
+        //! Number of workers.  <= 0 means one per CPU in cpus, if given, or
+        //!  one per core, otherwise.
+    int threads = 0;
+
+        //! If non-empty, worker i is pinned to cpus[i % cpus.size()].
+        //!  Supported on Linux (incl. Android) only.
+    std::vector< int > cpus;
+};
+
+
+    //! Counts of scheduler activity, since construction.
+struct SchedulerStats
+{
+    int64_t submitted;  //!< Tasks submitted.
+    int64_t executed;   //!< Tasks run.
+    int64_t stolen;     //!< Tasks run by a worker other than the one queued to.
+    int64_t superseded; //!< Dropped, due to a newer task in their TaskStream.
+    int64_t expired;    //!< Dropped, due to not starting by their deadline.
+    int64_t overran;    //!< Run, but finished after their deadline.
+
+        //! Tasks which didn't finish by their deadline.
+    int64_t deadlineMisses() const
+    {
+        return expired + overran;
+    }
+};
+
+
+    //! A sequence of per-frame tasks, of which only the newest queued runs.
+    /*!
+        Must outlive the tasks submitted with it.
+    */
+class TaskStream
+{
+public:
+    TaskStream();
+    TaskStream( const TaskStream & ) = delete;
+    TaskStream &operator=( const TaskStream & ) = delete;
+
+private:
+    friend class TaskScheduler;
+
+    std::atomic< uint64_t > generation_;
+};
+
+
+    //! Runs tasks on a pool of workers, which steal from each other.
+    /*!
+        Member functions may be called from any thread, including from tasks.
+        Tasks submitted from a worker are queued to that worker.  Others are
+        distributed round-robin.
+
+        The destructor discards queued tasks and waits for running ones.
+    */
+class TaskScheduler
+{
+public:
+    typedef std::chrono::steady_clock clock_type;
+    typedef std::function< void () > task_type;
+
+        //! @throws std::runtime_error if the CPU affinity can't be applied.
+    explicit TaskScheduler( const SchedulerParams &params = SchedulerParams() );
+
+    TaskScheduler( const TaskScheduler & ) = delete;
+    TaskScheduler &operator=( const TaskScheduler & ) = delete;
+
+    ~TaskScheduler();
+
+        //! Queues a task, without a deadline.
+    void submit( task_type task );
+
+        //! Queues a task, which is dropped if it can't start by deadline.
+    void submit( task_type task, clock_type::time_point deadline );
+
+        //! Queues a task, superseding any of stream's tasks still queued.
+    void submit(
+        TaskStream &stream,
+        task_type task,
+        clock_type::time_point deadline = clock_type::time_point::max() );
+
+        //! Blocks until no tasks are queued or running.
+        /*!
+            Don't call from a task.
+
+            @throws the first exception thrown by a task, since the last
+            call to wait().
+        */
+    void wait();
+
+    int threadCount() const;
+
+    SchedulerStats stats() const;
+
+private:
+    struct Task
+    {
+        task_type function;
+        clock_type::time_point deadline;
+        TaskStream *stream;
+        uint64_t generation;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque< Task > tasks;   // Owner uses the back; thieves, the front.
+        std::thread thread;
+    };
+
+    void enqueue( Task task );
+    void run( int index, int cpu );
+    bool take( int index, Task &task );
+    void execute( Task &task );
+    void shutdown();
+
+    std::vector< std::unique_ptr< Worker > > workers_;
+    std::atomic< unsigned > next_worker_;
+
+    std::mutex idle_mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable all_done_;
+    std::atomic< int64_t > queued_;
+    std::atomic< int64_t > outstanding_;    // Queued or running.
+    bool stopping_;
+
+    int started_;           // Workers which have applied their affinity.
+    bool affinity_failed_;
+    std::exception_ptr error_;
+
+    std::atomic< int64_t > submitted_;
+    std::atomic< int64_t > executed_;
+    std::atomic< int64_t > stolen_;
+    std::atomic< int64_t > superseded_;
+    std::atomic< int64_t > expired_;
+    std::atomic< int64_t > overran_;
+};
+
+
+    //! The CPUs with the highest maximum frequency (i.e. the big cores).
+    /*!
+        @returns an empty vector, if frequencies can't be determined (e.g.
+        off Linux), or all CPUs, if they're equal.
+    */
+std::vector< int > FastestCpus();
+
+
+} // namespace boleo
+
+
+#endif // BOLEO_TASK_SCHEDULER_HPP_
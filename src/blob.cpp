@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Direct conversion of TangoPointCloud into packed binary layouts.
+/*! @file
+
+    See blob.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/blob.hpp"
+#include "boleo/detail/common.hpp"
+#include "boleo/detail/features.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#if BOLEO_HAS_SSE2
+#   include <emmintrin.h>
+#elif BOLEO_HAS_NEON
+#   include <arm_neon.h>
+#endif
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+    // Converts a channel value to an integer type, rounding & saturating.
+template< typename T >
+T ToField( float value, std::true_type /* is_integral */ )
+{
+    typedef std::numeric_limits< T > limits;
+
+    const double rounded = std::nearbyint( double( value ) );
+    if (!(rounded >= double( limits::min() ))) return limits::min();
+    if (rounded >= double( limits::max() )) return limits::max();
+    return T( rounded );
+}
+
+
+template< typename T >
+T ToField( float value, std::false_type /* is_integral */ )
+{
+    return T( value );
+}
+
+
+    // Writes 1 channel of every point, as type T.
+template< typename T >
+void WriteChannel(
+    const float * BOLEO_RESTRICT in, int n, uint8_t * BOLEO_RESTRICT out, int32_t step )
+{
+    for (int i = 0; i < n; ++i)
+    {
+        const T value = ToField< T >( in[4*i], std::is_integral< T >() );
+        std::memcpy( out + int64_t( i )*step, &value, sizeof value );
+    }
+}
+
+} // namespace
+
+
+
+constexpr int32_t BlobXyz::point_step;
+constexpr int32_t BlobXyzi::point_step;
+
+
+BlobLayout BlobXyz::layout()
+{
+    BlobLayout result;
+    result.fields.push_back( { channel_x, 3, 0, blob_float32 } );
+    result.point_step = point_step;
+    return result;
+}
+
+
+BlobLayout BlobXyzi::layout()
+{
+    BlobLayout result;
+    result.fields.push_back( { channel_x, 4, 0, blob_float32 } );
+    result.point_step = point_step;
+    return result;
+}
+
+
+int BlobDatatype_size( BlobDatatype datatype )
+{
+    switch (datatype)
+    {
+        case blob_int8:
+        case blob_uint8:
+            return 1;
+
+        case blob_int16:
+        case blob_uint16:
+            return 2;
+
+        case blob_int32:
+        case blob_uint32:
+        case blob_float32:
+            return 4;
+
+        case blob_float64:
+            return 8;
+    }
+
+    throw std::invalid_argument( "Unknown BlobDatatype" );
+}
+
+
+template<> void PointCloud_toBlob< BlobXyz >( const TangoPointCloud *cloud, uint8_t *out )
+{
+    const int n = int( cloud->num_points );
+    if (n == 0) return;
+
+    const float * BOLEO_RESTRICT in = cloud->points[0];
+    int i = 0;
+
+#if BOLEO_HAS_SSE2
+        // Each 16-byte store spills into the next point, which overwrites it.
+        //  So, the final point must be written separately.
+    for (; i + 1 < n; ++i)
+    {
+        _mm_storeu_ps( reinterpret_cast< float * >( out + 12*i ), _mm_loadu_ps( in + 4*i ) );
+    }
+#elif BOLEO_HAS_NEON
+    for (; i + 4 <= n; i += 4)
+    {
+        const float32x4x4_t p = vld4q_f32( in + 4*i );
+        const float32x4x3_t xyz = { { p.val[0], p.val[1], p.val[2] } };
+        vst3q_f32( reinterpret_cast< float * >( out + 12*i ), xyz );
+    }
+#endif
+
+    for (; i < n; ++i) std::memcpy( out + 12*i, in + 4*i, 12 );
+}
+
+
+template<> void PointCloud_toBlob< BlobXyzi >( const TangoPointCloud *cloud, uint8_t *out )
+{
+    if (cloud->num_points == 0) return;
+
+    std::memcpy( out, cloud->points[0], size_t( cloud->num_points )*BlobXyzi::point_step );
+}
+
+
+void BlobLayout_validate( const BlobLayout &layout )
+{
+    if (layout.point_step < 1) throw std::invalid_argument( "BlobLayout point_step must be positive" );
+
+    for (const BlobField &field: layout.fields)
+    {
+        const int size = BlobDatatype_size( field.datatype );
+        if (field.channel < channel_x || field.channel > channel_confidence
+            || field.count < 1 || field.count > channel_confidence + 1 - field.channel)
+        {
+            throw std::invalid_argument( "BlobField channels out of range" );
+        }
+
+        if (field.offset < 0 || int64_t( field.offset ) + field.count*size > layout.point_step)
+        {
+            throw std::invalid_argument( "BlobField lies outside point_step" );
+        }
+    }
+}
+
+
+void PointCloud_toBlob( const TangoPointCloud *cloud, const BlobLayout &layout, uint8_t *out )
+{
+    BlobLayout_validate( layout );
+
+    const int n = int( cloud->num_points );
+    if (n == 0) return;
+
+        // Channel-at-a-time keeps the inner loops free of datatype dispatch.
+    for (const BlobField &field: layout.fields)
+    {
+        const int size = BlobDatatype_size( field.datatype );
+        for (int c = 0; c != field.count; ++c)
+        {
+            const float *in = cloud->points[0] + field.channel + c;
+            uint8_t *dest = out + field.offset + c*size;
+            const int32_t step = layout.point_step;
+
+            switch (field.datatype)
+            {
+                case blob_int8:     WriteChannel< int8_t   >( in, n, dest, step ); break;
+                case blob_uint8:    WriteChannel< uint8_t  >( in, n, dest, step ); break;
+                case blob_int16:    WriteChannel< int16_t  >( in, n, dest, step ); break;
+                case blob_uint16:   WriteChannel< uint16_t >( in, n, dest, step ); break;
+                case blob_int32:    WriteChannel< int32_t  >( in, n, dest, step ); break;
+                case blob_uint32:   WriteChannel< uint32_t >( in, n, dest, step ); break;
+                case blob_float32:  WriteChannel< float    >( in, n, dest, step ); break;
+                case blob_float64:  WriteChannel< double   >( in, n, dest, step ); break;
+            }
+        }
+    }
+}
+
+
+} // namespace boleo
@@ -0,0 +1,440 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! C++20 coroutine access to the frames of a TangoFrameHub.
+/*! @file
+
+    See coroutine.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/coroutine.hpp"
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+// class Executor:
+Executor::~Executor()
+{
+}
+
+
+
+// class InlineExecutor:
+void InlineExecutor::post( std::coroutine_handle<> handle )
+{
+    handle.resume();
+}
+
+
+
+// class RunLoopExecutor:
+RunLoopExecutor::RunLoopExecutor()
+: stopped_( false )
+{
+}
+
+
+void RunLoopExecutor::post( std::coroutine_handle<> handle )
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        pending_.push_back( handle );
+    }
+    ready_.notify_one();
+}
+
+
+void RunLoopExecutor::run()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock< std::mutex > lock( mutex_ );
+            ready_.wait( lock, [this] { return stopped_ || !pending_.empty(); } );
+            if (stopped_)
+            {
+                stopped_ = false;
+                return;
+            }
+
+            pending_.swap( running_ );
+        }
+
+        for (std::coroutine_handle<> handle: running_) handle.resume();
+        running_.clear();
+    }
+}
+
+
+int RunLoopExecutor::poll()
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        pending_.swap( running_ );
+    }
+
+    const int count = int( running_.size() );
+    for (std::coroutine_handle<> handle: running_) handle.resume();
+    running_.clear();
+    return count;
+}
+
+
+void RunLoopExecutor::stop()
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        stopped_ = true;
+    }
+    ready_.notify_all();
+}
+
+
+
+// class Cancellation:
+Cancellation::Cancellation()
+: cancelled_( false ), head_( nullptr )
+{
+}
+
+
+void Cancellation::cancel()
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+    cancelled_ = true;
+
+    while (detail::AwaitCore *await = head_)
+    {
+        head_ = await->cancel_next_;
+        if (head_) head_->cancel_prev_ = nullptr;
+        await->cancel_linked_ = false;
+
+        if (await->tryClaim( stream_cancelled ))
+        {
+            lock.unlock();
+            await->finish();
+            lock.lock();
+        }
+    }
+}
+
+
+bool Cancellation::cancelled() const
+{
+    return cancelled_.load( std::memory_order_acquire );
+}
+
+
+bool Cancellation::add( detail::AwaitCore *await )
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if (cancelled_) return false;
+
+    await->cancel_prev_ = nullptr;
+    await->cancel_next_ = head_;
+    if (head_) head_->cancel_prev_ = await;
+    head_ = await;
+    await->cancel_linked_ = true;
+    return true;
+}
+
+
+void Cancellation::remove( detail::AwaitCore *await )
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if (!await->cancel_linked_) return;
+
+    if (await->cancel_prev_) await->cancel_prev_->cancel_next_ = await->cancel_next_;
+    else head_ = await->cancel_next_;
+
+    if (await->cancel_next_) await->cancel_next_->cancel_prev_ = await->cancel_prev_;
+    await->cancel_linked_ = false;
+}
+
+
+
+namespace detail
+{
+
+
+// class TimerQueue:
+TimerQueue::TimerQueue()
+: head_( nullptr ), stopping_( false )
+{
+}
+
+
+TimerQueue::~TimerQueue()
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        stopping_ = true;
+    }
+    changed_.notify_all();
+
+    if (thread_.joinable()) thread_.join();
+}
+
+
+void TimerQueue::add( AwaitCore *await )
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        if (!thread_.joinable()) thread_ = std::thread( &TimerQueue::run, this );
+
+            // Few awaits are ever outstanding, so a linear insertion suffices.
+        AwaitCore *prev = nullptr;
+        AwaitCore *next = head_;
+        while (next && next->deadline_ <= await->deadline_)
+        {
+            prev = next;
+            next = next->timer_next_;
+        }
+
+        await->timer_prev_ = prev;
+        await->timer_next_ = next;
+        if (prev) prev->timer_next_ = await;
+        else head_ = await;
+
+        if (next) next->timer_prev_ = await;
+        await->timer_linked_ = true;
+
+        if (prev) return;   // The earliest deadline is unchanged.
+    }
+
+    changed_.notify_one();
+}
+
+
+void TimerQueue::remove( AwaitCore *await )
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if (!await->timer_linked_) return;
+
+    if (await->timer_prev_) await->timer_prev_->timer_next_ = await->timer_next_;
+    else head_ = await->timer_next_;
+
+    if (await->timer_next_) await->timer_next_->timer_prev_ = await->timer_prev_;
+    await->timer_linked_ = false;
+}
+
+
+void TimerQueue::run()
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+    while (!stopping_)
+    {
+        if (!head_)
+        {
+            changed_.wait( lock );
+            continue;
+        }
+
+            // Copied, since head_ may be removed while waiting.
+        const std::chrono::steady_clock::time_point deadline = head_->deadline_;
+        if (std::chrono::steady_clock::now() < deadline)
+        {
+            changed_.wait_until( lock, deadline );
+            continue;
+        }
+
+        AwaitCore *await = head_;
+        head_ = await->timer_next_;
+        if (head_) head_->timer_prev_ = nullptr;
+        await->timer_linked_ = false;
+
+        if (await->tryClaim( stream_timeout ))
+        {
+            lock.unlock();
+            await->finish();
+            lock.lock();
+        }
+    }
+}
+
+
+
+// class AwaitCore:
+AwaitCore::AwaitCore(
+    Executor &executor, TimerQueue &timers, const AwaitOptions &options )
+: status_( stream_ok ),
+  state_( registering ),
+  prior_( registering ),
+  executor_( &executor ),
+  timers_( &timers ),
+  timed_( options.timeout > std::chrono::steady_clock::duration::zero() ),
+  timer_prev_( nullptr ),
+  timer_next_( nullptr ),
+  timer_linked_( false ),
+  cancellation_( options.cancellation ),
+  cancel_prev_( nullptr ),
+  cancel_next_( nullptr ),
+  cancel_linked_( false )
+{
+    if (timed_) deadline_ = std::chrono::steady_clock::now() + options.timeout;
+}
+
+
+bool AwaitCore::claim( bool closed )
+{
+    return tryClaim( closed ? stream_closed : stream_ok );
+}
+
+
+void AwaitCore::wake()
+{
+    finish();
+}
+
+
+bool AwaitCore::suspend( std::coroutine_handle<> handle )
+{
+    handle_ = handle;
+
+        // Subscribing first means nothing needs undoing, if it throws.
+    bool registered = subscribe();
+    if (registered && cancellation_) registered = cancellation_->add( this );
+    if (registered && timed_) timers_->add( this );
+
+    if (!registered)
+    {
+        const StreamStatus status = cancellation_ && cancellation_->cancelled()
+            ? stream_cancelled : stream_ok;
+
+        if (tryClaim( status )) finish();
+        else waitFinished();
+
+        return false;
+    }
+
+    int expected = registering;
+    if (state_.compare_exchange_strong( expected, waiting, std::memory_order_acq_rel ))
+    {
+        return true;
+    }
+
+        // Completed during registration.  The winner won't post, so resume now.
+    waitFinished();
+    return false;
+}
+
+
+bool AwaitCore::tryClaim( StreamStatus status )
+{
+    int state = state_.load( std::memory_order_acquire );
+    while (state == registering || state == waiting)
+    {
+        if (state_.compare_exchange_weak( state, claimed, std::memory_order_acq_rel ))
+        {
+            prior_ = state;
+            status_ = status;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void AwaitCore::finish()
+{
+    unsubscribe();
+    if (cancellation_) cancellation_->remove( this );
+    if (timed_) timers_->remove( this );
+
+    if (prior_ == waiting)
+    {
+            // Once posted, this object may be destroyed at any moment.
+        Executor *executor = executor_;
+        std::coroutine_handle<> handle = handle_;
+        executor->post( handle );
+    }
+    else state_.store( finished, std::memory_order_release );
+}
+
+
+void AwaitCore::waitFinished() const
+{
+        // The winner holds no locks & has at most a few to take, briefly.
+    while (state_.load( std::memory_order_acquire ) != finished) std::this_thread::yield();
+}
+
+
+} // namespace detail
+
+
+
+// class FrameStreams:
+FrameStreams::FrameStreams(
+    TangoFrameHub &hub, Executor &executor, const QueuePolicy &policy )
+: hub_( hub ), executor_( executor ), policy_( policy )
+{
+}
+
+
+FrameStreams::~FrameStreams()
+{
+    if (clouds_) clouds_->close();
+    for (auto &entry: images_) entry.second->close();
+    for (auto &entry: poses_) entry.second->close();
+}
+
+
+FrameAwaiter< CloudFrame > FrameStreams::nextPointCloud( const AwaitOptions &options )
+{
+    std::shared_ptr< Subscription< CloudFrame > > subscription;
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        if (!clouds_) clouds_ = hub_.clouds().subscribe( policy_ );
+        subscription = clouds_;
+    }
+
+    return FrameAwaiter< CloudFrame >( std::move( subscription ), executor_, timers_, options );
+}
+
+
+FrameAwaiter< PoseFrame > FrameStreams::nextPose(
+    const TangoCoordinateFramePair &frame_pair, const AwaitOptions &options )
+{
+    std::shared_ptr< Subscription< PoseFrame > > subscription;
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        std::shared_ptr< Subscription< PoseFrame > > &entry =
+            poses_[ pose_key( frame_pair.base, frame_pair.target ) ];
+
+        if (!entry) entry = hub_.subscribePoses( frame_pair, policy_ );
+        subscription = entry;
+    }
+
+    return FrameAwaiter< PoseFrame >( std::move( subscription ), executor_, timers_, options );
+}
+
+
+FrameAwaiter< ImageFrame > FrameStreams::nextImage(
+    TangoCameraId camera, const AwaitOptions &options )
+{
+    std::shared_ptr< Subscription< ImageFrame > > subscription;
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        std::shared_ptr< Subscription< ImageFrame > > &entry = images_[ camera ];
+        if (!entry) entry = hub_.subscribeImages( camera, policy_ );
+        subscription = entry;
+    }
+
+    return FrameAwaiter< ImageFrame >( std::move( subscription ), executor_, timers_, options );
+}
+
+
+} // namespace boleo
@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Organized depth image, projected from a TangoPointCloud.
+/*! @file
+
+    See depth_image.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/depth_image.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+// class DepthImage:
+DepthImage::DepthImage()
+: width_( 0 ), height_( 0 ), camera_()
+{
+}
+
+
+void DepthImage::reset( int width, int height, const PinholeCamera &camera )
+{
+    if (width < 0 || height < 0) throw std::invalid_argument( "DepthImage dimensions must be non-negative" );
+
+    width_ = width;
+    height_ = height;
+    camera_ = camera;
+    depth_.assign( size_t( width )*height, 0.0f );
+}
+
+
+int DepthImage::width() const
+{
+    return width_;
+}
+
+
+int DepthImage::height() const
+{
+    return height_;
+}
+
+
+const PinholeCamera &DepthImage::camera() const
+{
+    return camera_;
+}
+
+
+float *DepthImage::row( int y )
+{
+    return depth_.data() + size_t( y )*width_;
+}
+
+
+const float *DepthImage::row( int y ) const
+{
+    return depth_.data() + size_t( y )*width_;
+}
+
+
+bool DepthImage::unproject( int x, int y, float *point ) const
+{
+    const float z = row( y )[x];
+    if (!(z > 0.0f)) return false;
+
+    point[0] = (float( x ) - camera_.cx)*z/camera_.fx;
+    point[1] = (float( y ) - camera_.cy)*z/camera_.fy;
+    point[2] = z;
+    return true;
+}
+
+
+
+PinholeCamera PinholeCamera_fromIntrinsics( const TangoCameraIntrinsics *intrinsics, int divisor )
+{
+    if (divisor < 1) throw std::invalid_argument( "Scale divisor must be at least 1" );
+
+        // Pixel centers are at integer coordinates, so the principal point shifts by half a pixel.
+    const float scale = 1.0f/float( divisor );
+    PinholeCamera result;
+    result.fx = float( intrinsics->fx )*scale;
+    result.fy = float( intrinsics->fy )*scale;
+    result.cx = (float( intrinsics->cx ) + 0.5f)*scale - 0.5f;
+    result.cy = (float( intrinsics->cy ) + 0.5f)*scale - 0.5f;
+    return result;
+}
+
+
+void PointCloud_toDepthImage(
+    const TangoPointCloud *cloud, const TangoCameraIntrinsics *intrinsics, DepthImage &result, int divisor )
+{
+    const PinholeCamera camera = PinholeCamera_fromIntrinsics( intrinsics, divisor );
+    const int width = int( intrinsics->width )/divisor;
+    const int height = int( intrinsics->height )/divisor;
+    result.reset( width, height, camera );
+
+    for (uint32_t i = 0; i != cloud->num_points; ++i)
+    {
+        const float *p = cloud->points[i];
+        const float z = p[2];
+        if (!(z > 0.0f)) continue;
+
+        const float u = std::floor( camera.fx*p[0]/z + camera.cx + 0.5f );
+        const float v = std::floor( camera.fy*p[1]/z + camera.cy + 0.5f );
+        if (!(u >= 0.0f && u < float( width ) && v >= 0.0f && v < float( height ))) continue;
+
+        float &pixel = result.row( int( v ) )[ int( u ) ];
+        if (pixel == 0.0f || z < pixel) pixel = z;
+    }
+}
+
+
+void DepthImage_halve( const DepthImage &image, DepthImage &result )
+{
+    const PinholeCamera &in = image.camera();
+    const PinholeCamera camera = {
+        in.fx*0.5f, in.fy*0.5f, (in.cx + 0.5f)*0.5f - 0.5f, (in.cy + 0.5f)*0.5f - 0.5f };
+
+    const int width = image.width()/2;
+    const int height = image.height()/2;
+    result.reset( width, height, camera );
+
+    for (int y = 0; y < height; ++y)
+    {
+        const float *top = image.row( 2*y );
+        const float *bottom = image.row( 2*y + 1 );
+        float *out = result.row( y );
+
+        for (int x = 0; x < width; ++x)
+        {
+            const float block[4] = { top[2*x], top[2*x + 1], bottom[2*x], bottom[2*x + 1] };
+
+            float nearest = 0.0f;
+            for (float z: block)
+            {
+                if (z > 0.0f && (nearest == 0.0f || z < nearest)) nearest = z;
+            }
+
+            if (nearest == 0.0f) continue;
+
+            const float limit = nearest*1.05f;
+            float sum = 0.0f;
+            int count = 0;
+            for (float z: block)
+            {
+                if (z > 0.0f && z <= limit)
+                {
+                    sum += z;
+                    ++count;
+                }
+            }
+
+            out[x] = sum/float( count );
+        }
+    }
+}
+
+
+} // namespace boleo
@@ -0,0 +1,331 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Publish/subscribe fan-out of Tango frames.
+/*! @file
+
+    See frame_hub.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/frame_hub.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace detail
+{
+
+
+// class FramePoolCore:
+FramePoolCore::FramePoolCore( int max_free )
+: max_free_( max_free )
+{
+}
+
+
+FramePoolCore::~FramePoolCore()
+{
+    for (PooledFrame *frame: free_) delete frame;
+}
+
+
+PooledFrame *FramePoolCore::take()
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if (free_.empty()) return nullptr;
+
+    PooledFrame *frame = free_.back();
+    free_.pop_back();
+    return frame;
+}
+
+
+void FramePoolCore::release( PooledFrame *frame )
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        if (int( free_.size() ) < max_free_)
+        {
+            free_.push_back( frame );
+            return;
+        }
+    }
+
+    delete frame;
+}
+
+
+int FramePoolCore::freeCount() const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    return int( free_.size() );
+}
+
+
+} // namespace detail
+
+
+
+// class PooledFrame:
+PooledFrame::PooledFrame()
+: refs_( 0 )
+{
+}
+
+
+PooledFrame::~PooledFrame()
+{
+}
+
+
+int PooledFrame::useCount() const
+{
+    return refs_.load( std::memory_order_relaxed );
+}
+
+
+void PooledFrame::addRef() const
+{
+    refs_.fetch_add( 1, std::memory_order_relaxed );
+}
+
+
+void PooledFrame::release() const
+{
+    if (refs_.fetch_sub( 1, std::memory_order_acq_rel ) != 1) return;
+
+    PooledFrame *self = const_cast< PooledFrame * >( this );
+    if (std::shared_ptr< detail::FramePoolCore > pool = pool_.lock())
+    {
+        pool->release( self );
+    }
+    else delete self;
+}
+
+
+
+// class CloudFrame:
+void CloudFrame::assign( const TangoPointCloud *cloud )
+{
+    header_ = *cloud;
+    points_.resize( size_t( cloud->num_points ) * 4 );
+    if (cloud->num_points)
+    {
+        std::memcpy( points_.data(), cloud->points[0], points_.size() * sizeof (float) );
+    }
+
+    header_.points = reinterpret_cast< float (*)[4] >( points_.data() );
+}
+
+
+double CloudFrame::timestamp() const
+{
+    return header_.timestamp;
+}
+
+
+int CloudFrame::size() const
+{
+    return int( header_.num_points );
+}
+
+
+TangoPointCloud CloudFrame::view() const
+{
+    return header_;
+}
+
+
+
+// class ImageFrame:
+void ImageFrame::assign( TangoCameraId camera, const TangoImageBuffer *buffer )
+{
+    camera_ = camera;
+    header_ = *buffer;
+    data_.resize( ImageBuffer_size( buffer ) );
+    if (!data_.empty()) std::memcpy( data_.data(), buffer->data, data_.size() );
+
+    header_.data = data_.data();
+}
+
+
+TangoCameraId ImageFrame::camera() const
+{
+    return camera_;
+}
+
+
+double ImageFrame::timestamp() const
+{
+    return header_.timestamp;
+}
+
+
+TangoImageBuffer ImageFrame::view() const
+{
+    return header_;
+}
+
+
+
+// class PoseFrame:
+void PoseFrame::assign( const TangoPoseData *pose )
+{
+    pose_ = *pose;
+}
+
+
+double PoseFrame::timestamp() const
+{
+    return pose_.timestamp;
+}
+
+
+const TangoPoseData &PoseFrame::pose() const
+{
+    return pose_;
+}
+
+
+
+size_t ImageBuffer_size( const TangoImageBuffer *buffer )
+{
+    const size_t plane = size_t( buffer->stride ) * buffer->height;
+    switch (buffer->format)
+    {
+        case TANGO_HAL_PIXEL_FORMAT_RGBA_8888:
+            return plane;
+
+            // A full-size luma plane, followed by 2 quarter-size chroma planes.
+        case TANGO_HAL_PIXEL_FORMAT_YV12:
+        case TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP:
+            return plane + plane/2;
+    }
+
+    throw std::invalid_argument( "Unrecognized TangoImageFormatType" );
+}
+
+
+
+// class TangoFrameHub:
+TangoFrameHub::TangoFrameHub( int pool_size )
+: cloud_pool_( pool_size ),
+  image_pool_( pool_size ),
+  pose_pool_( pool_size ),
+  dropped_( 0 )
+{
+}
+
+
+void TangoFrameHub::onPointCloudAvailable( const TangoPointCloud *cloud ) noexcept
+{
+    try
+    {
+        if (clouds_.subscriberCount() == 0) return;
+
+        FrameRef< CloudFrame > frame = cloud_pool_.acquire();
+        frame->assign( cloud );
+        clouds_.publish( std::move( frame ) );
+    }
+    catch (...)
+    {
+        dropped_.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+
+void TangoFrameHub::onFrameAvailable( TangoCameraId camera, const TangoImageBuffer *buffer ) noexcept
+{
+        // ImageBuffer_size() throws for unrecognized formats.
+    try
+    {
+        if (images_.subscriberCount() == 0) return;
+
+        FrameRef< ImageFrame > frame = image_pool_.acquire();
+        frame->assign( camera, buffer );
+        images_.publish( std::move( frame ) );
+    }
+    catch (...)
+    {
+        dropped_.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+
+void TangoFrameHub::onPoseAvailable( const TangoPoseData *pose ) noexcept
+{
+    try
+    {
+        if (poses_.subscriberCount() == 0) return;
+
+        FrameRef< PoseFrame > frame = pose_pool_.acquire();
+        frame->assign( pose );
+        poses_.publish( std::move( frame ) );
+    }
+    catch (...)
+    {
+        dropped_.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+
+int64_t TangoFrameHub::dropped() const
+{
+    return dropped_.load( std::memory_order_relaxed );
+}
+
+
+FrameHub< CloudFrame > &TangoFrameHub::clouds()
+{
+    return clouds_;
+}
+
+
+FrameHub< ImageFrame > &TangoFrameHub::images()
+{
+    return images_;
+}
+
+
+FrameHub< PoseFrame > &TangoFrameHub::poses()
+{
+    return poses_;
+}
+
+
+std::shared_ptr< Subscription< ImageFrame > > TangoFrameHub::subscribeImages(
+    TangoCameraId camera, const QueuePolicy &policy )
+{
+    return images_.subscribe( policy,
+        [camera]( const ImageFrame &frame ) { return frame.camera() == camera; } );
+}
+
+
+std::shared_ptr< Subscription< PoseFrame > > TangoFrameHub::subscribePoses(
+    const TangoCoordinateFramePair &frame_pair, const QueuePolicy &policy )
+{
+    return poses_.subscribe( policy,
+        [frame_pair]( const PoseFrame &frame )
+        {
+            return frame.pose().frame.base == frame_pair.base
+                && frame.pose().frame.target == frame_pair.target;
+        } );
+}
+
+
+} // namespace boleo
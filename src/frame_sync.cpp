@@ -0,0 +1,230 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Timestamp matching of clouds, images & poses from a hub.
+/*! @file
+
+    See frame_sync.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/frame_sync.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Orders frames by timestamp.
+    struct TimestampLess
+    {
+        template< typename pointer_type >
+        bool operator()( const pointer_type &frame, double t ) const
+        {
+            return frame->timestamp() < t;
+        }
+
+        template< typename pointer_type >
+        bool operator()( double t, const pointer_type &frame ) const
+        {
+            return t < frame->timestamp();
+        }
+    };
+
+
+        // Moves newly-delivered frames into the stream's sorted frames, discarding the oldest once at capacity.
+        //  Frames before horizon can't be matched, so are discarded without counting as drops.  Neither are those
+        //  discarded at capacity, unless a cloud is waiting for them.
+    template< typename stream_type >
+    void Drain( stream_type &stream, double horizon, bool waiting )
+    {
+        if (!stream.subscription) return;
+
+        typename decltype( stream.frames )::value_type frame;
+        while (stream.subscription->tryPop( frame ))
+        {
+            if (frame->timestamp() < horizon) continue;
+
+                // Frames normally arrive in order, so this usually appends.
+            const auto position =
+                std::upper_bound( stream.frames.begin(), stream.frames.end(), frame->timestamp(), TimestampLess() );
+
+            stream.frames.insert( position, std::move( frame ) );
+            if (int( stream.frames.size() ) > stream.capacity)
+            {
+                stream.frames.erase( stream.frames.begin() );
+                if (waiting) ++stream.dropped;
+            }
+        }
+    }
+
+
+        // Finds the index of the frame nearest t, or -1 if there's none, or if a nearer one might yet arrive (unless
+        //  settled).
+    template< typename frames_type >
+    int Nearest( const frames_type &frames, double t, bool settled )
+    {
+        if (frames.empty() || (!settled && frames.back()->timestamp() < t)) return -1;
+
+        const auto after = std::lower_bound( frames.begin(), frames.end(), t, TimestampLess() );
+        int i = int( after - frames.begin() );
+        if (i == int( frames.size() )) return i - 1;
+        if (i > 0 && t - frames[ i - 1 ]->timestamp() <= frames[i]->timestamp() - t) --i;
+        return i;
+    }
+
+
+        // Discards frames before index i.
+    template< typename frames_type >
+    void EraseBefore( frames_type &frames, int i )
+    {
+        frames.erase( frames.begin(), frames.begin() + i );
+    }
+
+
+        // Discards frames before time t.
+    template< typename frames_type >
+    void EraseOlder( frames_type &frames, double t )
+    {
+        frames.erase( frames.begin(), std::lower_bound( frames.begin(), frames.end(), t, TimestampLess() ) );
+    }
+
+
+        // Total frames dropped by the stream.
+    template< typename stream_type >
+    int64_t Dropped( const stream_type &stream )
+    {
+        return stream.dropped + (stream.subscription ? stream.subscription->stats().dropped : 0);
+    }
+
+}
+
+
+// class FrameSynchronizer:
+FrameSynchronizer::FrameSynchronizer( TangoFrameHub &hub, const SyncParams &params )
+: params_( params ), last_cloud_( -std::numeric_limits< double >::infinity() ), matched_( 0 ), unmatched_( 0 )
+{
+    if (!(params_.tolerance >= 0.0)) throw std::invalid_argument( "SyncParams::tolerance must be non-negative" );
+
+    const int capacities[] = { params_.cloud_capacity, params_.image_capacity, params_.pose_capacity };
+    for (int capacity: capacities)
+    {
+        if (capacity < 1) throw std::invalid_argument( "SyncParams capacities must be positive" );
+    }
+
+    clouds_.capacity = params_.cloud_capacity;
+    images_.capacity = params_.image_capacity;
+    poses_.capacity = params_.pose_capacity;
+    clouds_.dropped = images_.dropped = poses_.dropped = 0;
+
+        // Subscribe to the candidates first, so that none is missed for the first cloud.
+    if (params_.images)
+    {
+        images_.subscription = hub.subscribeImages( params_.camera, Bounded( params_.image_capacity ) );
+    }
+    if (params_.poses)
+    {
+        poses_.subscription = hub.subscribePoses( params_.pose_frames, Bounded( params_.pose_capacity ) );
+    }
+    clouds_.subscription = hub.clouds().subscribe( Bounded( params_.cloud_capacity ) );
+}
+
+
+bool FrameSynchronizer::tryPop( SyncedFrames &result )
+{
+    Drain( clouds_, -std::numeric_limits< double >::infinity(), true );
+    const bool waiting = !clouds_.frames.empty();
+
+        // Candidates too old for the next cloud (or, failing that, any cloud after the last) can't be matched, so
+        //  needn't occupy the queues.
+    const double horizon = (clouds_.frames.empty() ? last_cloud_ : clouds_.frames.front()->timestamp())
+        - params_.tolerance;
+
+    EraseOlder( images_.frames, horizon );
+    EraseOlder( poses_.frames, horizon );
+    Drain( images_, horizon, waiting );
+    Drain( poses_, horizon, waiting );
+
+    while (!clouds_.frames.empty())
+    {
+        const double t = clouds_.frames.front()->timestamp();
+
+            // Once a later cloud arrives beyond the tolerance, any partners should have too, so the match is decided
+            //  with the frames present.  A stalled stream then leaves clouds unmatched, rather than blocking them.
+        const bool settled = clouds_.frames.back()->timestamp() > t + params_.tolerance;
+
+            // A disabled stream is treated as matching at index 0, without being consulted.
+        const int image = params_.images ? Nearest( images_.frames, t, settled ) : 0;
+        const int pose = params_.poses ? Nearest( poses_.frames, t, settled ) : 0;
+        if ((image < 0 || pose < 0) && !settled) return false;
+
+        const auto near = [&]( double timestamp ) { return std::fabs( timestamp - t ) <= params_.tolerance; };
+        const bool matched =
+            (!params_.images || (image >= 0 && near( images_.frames[image]->timestamp() )))
+            && (!params_.poses || (pose >= 0 && near( poses_.frames[pose]->timestamp() )));
+
+        if (matched)
+        {
+            result.cloud = std::move( clouds_.frames.front() );
+            result.image = params_.images ? images_.frames[image] : ImageFramePtr();
+            result.pose = params_.poses ? poses_.frames[pose] : PoseFramePtr();
+
+                // Later clouds are no earlier, so can't be nearer to earlier frames.  The matched frames are
+                //  retained, as they may also be nearest to the next cloud.
+            last_cloud_ = t;
+            clouds_.frames.erase( clouds_.frames.begin() );
+            if (params_.images) EraseBefore( images_.frames, image );
+            if (params_.poses) EraseBefore( poses_.frames, pose );
+
+            ++matched_;
+            return true;
+        }
+
+        last_cloud_ = t;
+        clouds_.frames.erase( clouds_.frames.begin() );
+        EraseOlder( images_.frames, t - params_.tolerance );
+        EraseOlder( poses_.frames, t - params_.tolerance );
+        ++unmatched_;
+    }
+
+    return false;
+}
+
+
+SyncStats FrameSynchronizer::stats() const
+{
+    SyncStats result;
+    result.matched = matched_;
+    result.unmatched = unmatched_;
+    result.dropped_clouds = Dropped( clouds_ );
+    result.dropped_images = Dropped( images_ );
+    result.dropped_poses = Dropped( poses_ );
+    return result;
+}
+
+
+const SyncParams &FrameSynchronizer::params() const
+{
+    return params_;
+}
+
+
+} // namespace boleo
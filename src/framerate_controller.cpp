@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Backpressure-driven depth framerate control.
+/*! @file
+
+    See framerate_controller.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/framerate_controller.hpp"
+#include "boleo/config.hpp"
+#include "boleo/exceptions.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+// class FramerateController:
+FramerateController::FramerateController( TangoConfig runtime_config, const FramerateParams &params )
+: config_( runtime_config ),
+  params_( params ),
+  framerate_( params.max_framerate ),
+  underloaded_( 0 ),
+  hold_( 0 ),
+  adjustments_( 0 ),
+  started_( clock_type::now() )
+{
+        // At 0 Hz, no more clouds would arrive to call update(), so the framerate could never be raised.
+    if (params_.min_framerate < 1 || params_.min_framerate > params_.max_framerate)
+    {
+        throw std::invalid_argument( "FramerateParams::min_framerate must be in [1, max_framerate]" );
+    }
+    if (params_.step < 1) throw std::invalid_argument( "FramerateParams::step must be positive" );
+    if (params_.raise_samples < 1) throw std::invalid_argument( "FramerateParams::raise_samples must be positive" );
+    if (params_.hold_samples < 0) throw std::invalid_argument( "FramerateParams::hold_samples must be non-negative" );
+    if (!(params_.throughput_window > 0.0))
+    {
+        throw std::invalid_argument( "FramerateParams::throughput_window must be positive" );
+    }
+
+    apply( framerate_ );
+}
+
+
+int32_t FramerateController::update( int queue_depth, double latency )
+{
+    const clock_type::time_point now = clock_type::now();
+    completions_.push_back( now );
+
+    const auto window = std::chrono::duration_cast< clock_type::duration >(
+        std::chrono::duration< double >( params_.throughput_window ) );
+
+    while (now - completions_.front() > window)
+    {
+        completions_.pop_front();
+    }
+
+    if (hold_ > 0)
+    {
+        --hold_;
+        return framerate_;
+    }
+
+    const bool overloaded =
+        queue_depth >= params_.high_queue_depth || latency >= params_.high_latency;
+
+    const bool underloaded =
+        queue_depth <= params_.low_queue_depth && latency <= params_.low_latency;
+
+    int32_t target = framerate_;
+    if (overloaded)
+    {
+        underloaded_ = 0;
+        target = std::max( framerate_ - params_.step, params_.min_framerate );
+    }
+    else if (underloaded)
+    {
+        if (++underloaded_ >= params_.raise_samples)
+        {
+            underloaded_ = 0;
+            target = std::min( framerate_ + params_.step, params_.max_framerate );
+        }
+    }
+    else underloaded_ = 0;
+
+    if (target != framerate_)
+    {
+        apply( target );
+        framerate_ = target;
+        hold_ = params_.hold_samples;
+        ++adjustments_;
+    }
+
+    return framerate_;
+}
+
+
+int32_t FramerateController::framerate() const
+{
+    return framerate_;
+}
+
+
+double FramerateController::throughput() const
+{
+        // update() only prunes when called, so skip completions which have since left the window.
+    const auto window = std::chrono::duration_cast< clock_type::duration >(
+        std::chrono::duration< double >( params_.throughput_window ) );
+
+    const clock_type::time_point now = clock_type::now();
+    const auto first = std::lower_bound( completions_.begin(), completions_.end(), now - window );
+    const auto count = completions_.end() - first;
+
+        // The window ends now, so the rate decays during a stall.  Until a full window has elapsed, it starts at
+        //  construction instead.
+    const std::chrono::duration< double > span = now - std::max( now - window, started_ );
+    if (span.count() <= 0.0) return 0.0;
+
+    return double( count ) / span.count();
+}
+
+
+int64_t FramerateController::adjustments() const
+{
+    return adjustments_;
+}
+
+
+const FramerateParams &FramerateController::params() const
+{
+    return params_;
+}
+
+
+void FramerateController::apply( int32_t framerate )
+{
+    Config_set< config_runtime_depth_framerate >( config_, framerate );
+    BOLEO_THROW_IF_ERROR( TangoService_setRuntimeConfig( config_ ) );
+}
+
+
+} // namespace boleo
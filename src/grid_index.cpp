@@ -0,0 +1,291 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Uniform-grid spatial index, for neighbor queries.
+/*! @file
+
+    See grid_index.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/grid_index.hpp"
+#include "boleo/point_cloud_soa.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Inserts a candidate into the k best so far, kept in ascending order.
+    void InsertNearest(
+        int k, int index, float distance_sq,
+        std::vector< int > &indices, std::vector< float > &distances_sq )
+    {
+        int pos = int( indices.size() );
+        if (pos == k)
+        {
+            if (distance_sq >= distances_sq.back()) return;
+            --pos;
+        }
+        else
+        {
+            indices.push_back( 0 );
+            distances_sq.push_back( 0.0f );
+        }
+
+        for (; pos > 0 && distances_sq[pos - 1] > distance_sq; --pos)
+        {
+            indices[pos] = indices[pos - 1];
+            distances_sq[pos] = distances_sq[pos - 1];
+        }
+
+        indices[pos] = index;
+        distances_sq[pos] = distance_sq;
+    }
+
+} // namespace
+
+
+
+const int32_t GridIndex::cell_limit;
+
+
+GridIndex::GridIndex( float cell_size )
+: inverse_size_( 1.0f ), size_( 0 ), bits_( 4 )
+{
+    setCellSize( cell_size );
+    begin( 0 );
+    finish();
+}
+
+
+void GridIndex::setCellSize( float cell_size )
+{
+    if (!(cell_size > 0.0f)) throw std::invalid_argument( "GridIndex cell size must be positive" );
+
+    cell_size_ = cell_size;
+}
+
+
+float GridIndex::cellSize() const
+{
+    return cell_size_;
+}
+
+
+void GridIndex::build( const TangoPointCloud *cloud )
+{
+    const int n = int( cloud->num_points );
+    begin( n );
+    for (int i = 0; i < n; ++i)
+    {
+        const float *p = cloud->points[i];
+        add( i, p[0], p[1], p[2] );
+    }
+    finish();
+}
+
+
+void GridIndex::build( const PointCloudSoA &cloud )
+{
+    const int n = cloud.size();
+    const float *x = cloud.x();
+    const float *y = cloud.y();
+    const float *z = cloud.z();
+
+    begin( n );
+    for (int i = 0; i < n; ++i) add( i, x[i], y[i], z[i] );
+    finish();
+}
+
+
+void GridIndex::begin( int size )
+{
+    if (size < 0) throw std::invalid_argument( "GridIndex size must be non-negative" );
+
+    inverse_size_ = 1.0f / cell_size_;
+    size_ = size;
+
+        // At least 1 bucket per point, which keeps most buckets to 1 cell.
+    bits_ = 4;
+    while (bits_ < 31 && (int64_t( 1 ) << bits_) < size) ++bits_;
+
+        // assign() & resize() retain capacity, so steady-state builds don't allocate.
+    keys_.resize( size );
+    staged_.resize( 3*size_t( size ) );
+    start_.assign( (size_t( 1 ) << bits_) + 1, 0 );
+
+    for (int a = 0; a < 3; ++a)
+    {
+        min_cell_[a] = cell_limit;
+        max_cell_[a] = -cell_limit - 1;
+    }
+}
+
+
+void GridIndex::finish()
+{
+    const size_t buckets = start_.size() - 1;
+    for (size_t b = 0; b < buckets; ++b) start_[b + 1] += start_[b];
+
+    cursor_.assign( start_.begin(), start_.end() - 1 );
+    entries_.resize( size_ );
+    entry_keys_.resize( size_ );
+
+    for (int i = 0; i < size_; ++i)
+    {
+        const uint64_t key = keys_[i];
+        const uint32_t slot = cursor_[ bucketOf( key ) ]++;
+        const float *p = &staged_[ 3*size_t( i ) ];
+
+        const Entry entry = { p[0], p[1], p[2], i };
+        entries_[slot] = entry;
+        entry_keys_[slot] = key;
+    }
+}
+
+
+int GridIndex::size() const
+{
+    return size_;
+}
+
+
+template< typename Fn >
+void GridIndex::forEachInCell( int32_t cx, int32_t cy, int32_t cz, Fn &fn ) const
+{
+    const uint64_t key = CellKey( cx, cy, cz );
+    const uint32_t bucket = bucketOf( key );
+
+        // Buckets may also hold other cells, which hash to the same bucket.
+    for (uint32_t i = start_[bucket], end = start_[bucket + 1]; i != end; ++i)
+    {
+        if (entry_keys_[i] == key) fn( entries_[i] );
+    }
+}
+
+
+int GridIndex::radiusSearch(
+    const float *point, float radius, std::vector< int > &indices, std::vector< float > &distances_sq ) const
+{
+    indices.clear();
+    distances_sq.clear();
+    if (size_ == 0 || !(radius >= 0.0f)) return 0;
+
+    int32_t lo[3];
+    int32_t hi[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        lo[a] = std::max( ToCell( point[a] - radius, inverse_size_ ), min_cell_[a] );
+        hi[a] = std::min( ToCell( point[a] + radius, inverse_size_ ), max_cell_[a] );
+    }
+
+    const float radius_sq = radius*radius;
+    auto visit = [&]( const Entry &entry )
+    {
+        const float dx = entry.x - point[0];
+        const float dy = entry.y - point[1];
+        const float dz = entry.z - point[2];
+        const float distance_sq = dx*dx + dy*dy + dz*dz;
+        if (distance_sq <= radius_sq)
+        {
+            indices.push_back( entry.index );
+            distances_sq.push_back( distance_sq );
+        }
+    };
+
+    for (int32_t cz = lo[2]; cz <= hi[2]; ++cz)
+    {
+        for (int32_t cy = lo[1]; cy <= hi[1]; ++cy)
+        {
+            for (int32_t cx = lo[0]; cx <= hi[0]; ++cx) forEachInCell( cx, cy, cz, visit );
+        }
+    }
+
+    return int( indices.size() );
+}
+
+
+int GridIndex::nearestKSearch(
+    const float *point, int k, std::vector< int > &indices, std::vector< float > &distances_sq ) const
+{
+    indices.clear();
+    distances_sq.clear();
+    k = std::min( k, size_ );
+    if (k <= 0) return 0;
+
+    auto visit = [&]( const Entry &entry )
+    {
+        const float dx = entry.x - point[0];
+        const float dy = entry.y - point[1];
+        const float dz = entry.z - point[2];
+        InsertNearest( k, entry.index, dx*dx + dy*dy + dz*dz, indices, distances_sq );
+    };
+
+    int32_t center[3];
+    int32_t extent = 0;     // Ring beyond which there are no points.
+    float margin = 1.0f;    // Distance from the query to its cell's nearest face, in cells.
+    for (int a = 0; a < 3; ++a)
+    {
+        center[a] = ToCell( point[a], inverse_size_ );
+        extent = std::max( extent, std::max( center[a] - min_cell_[a], max_cell_[a] - center[a] ) );
+
+        const float offset = point[a]*inverse_size_ - float( center[a] );
+        margin = std::min( margin, std::min( offset, 1.0f - offset ) );
+    }
+
+    margin = std::max( margin, 0.0f );
+
+        // Visit shells of cells at increasing Chebyshev distance (ring).  Points beyond ring r are
+        //  at least r + margin cells away, so once the kth best is nearer, the search is done.
+    for (int32_t ring = 0; ring <= extent; ++ring)
+    {
+        for (int32_t dz = -ring; dz <= ring; ++dz)
+        {
+            const int32_t cz = center[2] + dz;
+            if (cz < min_cell_[2] || cz > max_cell_[2]) continue;
+
+            for (int32_t dy = -ring; dy <= ring; ++dy)
+            {
+                const int32_t cy = center[1] + dy;
+                if (cy < min_cell_[1] || cy > max_cell_[1]) continue;
+
+                    // Inside the shell, only its 2 x faces are new.
+                const bool face = dz == -ring || dz == ring || dy == -ring || dy == ring;
+                const int32_t step = face ? 1 : std::max( 2*ring, 1 );
+                for (int32_t dx = -ring; dx <= ring; dx += step)
+                {
+                    const int32_t cx = center[0] + dx;
+                    if (cx >= min_cell_[0] && cx <= max_cell_[0]) forEachInCell( cx, cy, cz, visit );
+                }
+            }
+        }
+
+        if (int( indices.size() ) == k)
+        {
+            const float reach = (float( ring ) + margin)/inverse_size_;
+            if (distances_sq.back() <= reach*reach) break;
+        }
+    }
+
+    return int( indices.size() );
+}
+
+
+} // namespace boleo
@@ -0,0 +1,315 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Grayscale Gaussian pyramids of TangoImageBuffers.
+/*! @file
+
+    See image_pyramid.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/image_pyramid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if BOLEO_HAS_SSE2
+#   include <emmintrin.h>
+#elif BOLEO_HAS_NEON
+#   include <arm_neon.h>
+#endif
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Rows of filtered input retained per level: the height of the kernel.
+    const int kernel_size = 5;
+
+
+        // Maps an index just outside [0, size) back inside, by reflection about the edge pixels.
+    inline int Reflect( int i, int size )
+    {
+        if (i < 0) return -i;
+        if (i >= size) return 2*size - 2 - i;
+        return i;
+    }
+
+
+        // Row stride of level buffers, padded for SIMD alignment.
+    inline int PaddedStride( int width )
+    {
+        return (width + 15) & ~15;
+    }
+
+
+        // Applies the horizontal (1 4 6 4 1) kernel to a row of width pixels, at every other pixel.
+        /*
+            Produces (width + 1)/2 values, of up to 16*255, so they fit in 16 bits.
+        */
+    void FilterRow( const uint8_t *in, int width, uint16_t *out )
+    {
+        const int out_width = (width + 1)/2;
+
+            // Column 0 needs reflection.  From column 1, 8 outputs are produced per step, from 3 overlapping
+            //  loads of 16 input pixels, as long as they lie within the row.
+        out[0] = uint16_t( 6*in[0] + 8*in[ Reflect( 1, width ) ] + 2*in[ Reflect( 2, width ) ] );
+        int x = 1;
+#if BOLEO_HAS_SSE2
+        const __m128i low_bytes = _mm_set1_epi16( 0x00ff );
+        for (; 2*x + 17 < width; x += 8)
+        {
+            const __m128i left = _mm_loadu_si128( reinterpret_cast< const __m128i * >( in + 2*x - 2 ) );
+            const __m128i center = _mm_loadu_si128( reinterpret_cast< const __m128i * >( in + 2*x ) );
+            const __m128i right = _mm_loadu_si128( reinterpret_cast< const __m128i * >( in + 2*x + 2 ) );
+
+                // Even pixels are in the low byte of each 16-bit lane, odd pixels in the high byte.
+            const __m128i even = _mm_and_si128( center, low_bytes );
+            const __m128i odd = _mm_add_epi16( _mm_srli_epi16( left, 8 ), _mm_srli_epi16( center, 8 ) );
+            const __m128i outer = _mm_add_epi16( _mm_and_si128( left, low_bytes ), _mm_and_si128( right, low_bytes ) );
+
+            __m128i sum = _mm_add_epi16( outer, _mm_slli_epi16( odd, 2 ) );
+            sum = _mm_add_epi16( sum, _mm_add_epi16( _mm_slli_epi16( even, 2 ), _mm_slli_epi16( even, 1 ) ) );
+            _mm_storeu_si128( reinterpret_cast< __m128i * >( out + x ), sum );
+        }
+#elif BOLEO_HAS_NEON
+        for (; 2*x + 17 < width; x += 8)
+        {
+                // De-interleaving loads separate even & odd pixels.
+            const uint8x8x2_t left = vld2_u8( in + 2*x - 2 );
+            const uint8x8x2_t center = vld2_u8( in + 2*x );
+            const uint8x8x2_t right = vld2_u8( in + 2*x + 2 );
+
+            const uint16x8_t outer = vaddl_u8( left.val[0], right.val[0] );
+            const uint16x8_t odd = vaddl_u8( left.val[1], center.val[1] );
+            const uint16x8_t sum = vaddq_u16( outer, vshlq_n_u16( odd, 2 ) );
+            vst1q_u16( out + x, vmlaq_n_u16( sum, vmovl_u8( center.val[0] ), 6 ) );
+        }
+#endif
+        for (; x < out_width; ++x)
+        {
+            const int c = 2*x;
+            const int right = in[ Reflect( c + 1, width ) ];
+            const int far_right = in[ Reflect( c + 2, width ) ];
+            out[x] = uint16_t( in[ c - 2 ] + 4*in[ c - 1 ] + 6*in[c] + 4*right + far_right );
+        }
+    }
+
+
+        // Applies the vertical (1 4 6 4 1) kernel to 5 filtered rows, with rounding & normalization.
+        /*
+            The total weight of the 2 passes is 256.  Sums of up to 256*255 (plus rounding) fit in 16 bits.
+        */
+    void FilterColumns( const uint16_t *const *rows, int width, uint8_t *out )
+    {
+        const uint16_t *r0 = rows[0];
+        const uint16_t *r1 = rows[1];
+        const uint16_t *r2 = rows[2];
+        const uint16_t *r3 = rows[3];
+        const uint16_t *r4 = rows[4];
+
+        int x = 0;
+#if BOLEO_HAS_SSE2
+        const __m128i rounding = _mm_set1_epi16( 128 );
+        for (; x + 8 <= width; x += 8)
+        {
+            const __m128i a = _mm_loadu_si128( reinterpret_cast< const __m128i * >( r0 + x ) );
+            const __m128i b = _mm_loadu_si128( reinterpret_cast< const __m128i * >( r1 + x ) );
+            const __m128i c = _mm_loadu_si128( reinterpret_cast< const __m128i * >( r2 + x ) );
+            const __m128i d = _mm_loadu_si128( reinterpret_cast< const __m128i * >( r3 + x ) );
+            const __m128i e = _mm_loadu_si128( reinterpret_cast< const __m128i * >( r4 + x ) );
+
+            __m128i sum = _mm_add_epi16( _mm_add_epi16( a, e ), rounding );
+            sum = _mm_add_epi16( sum, _mm_slli_epi16( _mm_add_epi16( b, d ), 2 ) );
+            sum = _mm_add_epi16( sum, _mm_add_epi16( _mm_slli_epi16( c, 2 ), _mm_slli_epi16( c, 1 ) ) );
+
+            const __m128i result = _mm_srli_epi16( sum, 8 );
+            _mm_storel_epi64( reinterpret_cast< __m128i * >( out + x ), _mm_packus_epi16( result, result ) );
+        }
+#elif BOLEO_HAS_NEON
+        for (; x + 8 <= width; x += 8)
+        {
+            uint16x8_t sum = vaddq_u16( vld1q_u16( r0 + x ), vld1q_u16( r4 + x ) );
+            sum = vaddq_u16( sum, vshlq_n_u16( vaddq_u16( vld1q_u16( r1 + x ), vld1q_u16( r3 + x ) ), 2 ) );
+            sum = vmlaq_n_u16( sum, vld1q_u16( r2 + x ), 6 );
+            vst1_u8( out + x, vrshrn_n_u16( sum, 8 ) );
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            const int sum = r0[x] + 4*r1[x] + 6*r2[x] + 4*r3[x] + r4[x];
+            out[x] = uint8_t( (sum + 128) >> 8 );
+        }
+    }
+
+
+        // Converts a row of RGBA pixels to gray, with BT.601 weights.
+    void GrayRow( const uint8_t *in, int width, uint8_t *out )
+    {
+        for (int x = 0; x < width; ++x, in += 4)
+        {
+            out[x] = uint8_t( (77*in[0] + 150*in[1] + 29*in[2] + 128) >> 8 );
+        }
+    }
+
+}
+
+
+// class ImagePyramid:
+ImagePyramid::ImagePyramid( const PyramidParams &params )
+: params_( params )
+{
+    if (params.levels < 1 || params.levels > 16)
+    {
+        throw std::invalid_argument( "PyramidParams::levels must be in [1, 16]" );
+    }
+    if (params.min_size < 2) throw std::invalid_argument( "PyramidParams::min_size must be at least 2" );
+}
+
+
+void ImagePyramid::build( const TangoImageBuffer *image )
+{
+    const PyramidRoi roi = { 0, 0, int( image->width ), int( image->height ) };
+    build( image, roi );
+}
+
+
+void ImagePyramid::build( const TangoImageBuffer *image, const PyramidRoi &roi )
+{
+    bool rgba = false;
+    switch (image->format)
+    {
+        case TANGO_HAL_PIXEL_FORMAT_RGBA_8888:
+            rgba = true;
+            break;
+
+        case TANGO_HAL_PIXEL_FORMAT_YV12:
+        case TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP:
+            break;
+
+        default:
+            throw std::invalid_argument( "Unrecognized TangoImageBuffer format" );
+    }
+
+    const int alignment = 1 << (params_.levels - 1);
+    const int left = std::max( roi.x, 0 )/alignment*alignment;
+    const int top = std::max( roi.y, 0 )/alignment*alignment;
+    const int right = int( std::min( int64_t( roi.x ) + roi.width, int64_t( image->width ) ) );
+    const int bottom = int( std::min( int64_t( roi.y ) + roi.height, int64_t( image->height ) ) );
+    if (right <= left || bottom <= top) throw std::invalid_argument( "PyramidRoi doesn't overlap the image" );
+
+        // Plan the levels, each centered on every other pixel of the one before.
+    PyramidLevel level = { nullptr, right - left, bottom - top, int( image->stride ), left, top };
+    levels_.clear();
+    levels_.push_back( level );
+    while (int( levels_.size() ) < params_.levels)
+    {
+        level.width = (level.width + 1)/2;
+        level.height = (level.height + 1)/2;
+        level.stride = PaddedStride( level.width );
+        level.x /= 2;
+        level.y /= 2;
+        if (level.width < params_.min_size || level.height < params_.min_size) break;
+
+        levels_.push_back( level );
+    }
+
+    if (buffers_.size() < levels_.size()) buffers_.resize( levels_.size() );
+
+    for (size_t i = 1; i < levels_.size(); ++i)
+    {
+        Buffers &buffers = buffers_[i];
+        buffers.pixels.resize( size_t( levels_[i].stride )*levels_[i].height );
+        buffers.filtered.resize( size_t( kernel_size )*levels_[i].width );
+        buffers.next_row = 0;
+        levels_[i].data = buffers.pixels.data();
+    }
+
+        // Level 0 is the luma plane itself, unless it must be converted.
+    PyramidLevel &base = levels_[0];
+    const uint8_t *source = image->data + size_t( top )*image->stride;
+    if (rgba)
+    {
+        base.stride = PaddedStride( base.width );
+        buffers_[0].pixels.resize( size_t( base.stride )*base.height );
+        base.data = buffers_[0].pixels.data();
+        source += 4*size_t( left );
+    }
+    else base.data = source + left;
+
+    for (int y = 0; y < base.height; ++y)
+    {
+        if (rgba)
+        {
+            uint8_t *gray = buffers_[0].pixels.data() + size_t( y )*base.stride;
+            GrayRow( source + size_t( y )*image->stride, base.width, gray );
+        }
+
+        feed( 0, y );
+    }
+}
+
+
+void ImagePyramid::feed( int i, int y )
+{
+    if (i + 1 >= int( levels_.size() )) return;
+
+    const PyramidLevel &in = levels_[i];
+    const PyramidLevel &out = levels_[ i + 1 ];
+    Buffers &buffers = buffers_[ i + 1 ];
+
+    FilterRow( in.data + size_t( y )*in.stride, in.width, &buffers.filtered[ size_t( y % kernel_size )*out.width ] );
+
+        // Output row j is centered on input row 2j, so it's ready once input row 2j + 2 (or the last) is in.
+    const int last = in.height - 1;
+    while (buffers.next_row < out.height)
+    {
+        const int j = buffers.next_row;
+        if (std::min( 2*j + 2, last ) > y) break;
+
+        const uint16_t *rows[kernel_size];
+        for (int k = 0; k < kernel_size; ++k)
+        {
+            const int row = Reflect( 2*j - 2 + k, in.height );
+            rows[k] = &buffers.filtered[ size_t( row % kernel_size )*out.width ];
+        }
+
+        FilterColumns( rows, out.width, buffers.pixels.data() + size_t( j )*out.stride );
+        ++buffers.next_row;
+        feed( i + 1, j );
+    }
+}
+
+
+int ImagePyramid::levels() const
+{
+    return int( levels_.size() );
+}
+
+
+const PyramidLevel &ImagePyramid::level( int i ) const
+{
+    return levels_[i];
+}
+
+
+const PyramidParams &ImagePyramid::params() const
+{
+    return params_;
+}
+
+
+} // namespace boleo
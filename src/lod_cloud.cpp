@@ -0,0 +1,320 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Multi-resolution point cloud, for rendering & streaming.
+/*! @file
+
+    See lod_cloud.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/lod_cloud.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Nodes closer than this (in meters, beyond their bounding sphere) are treated as being this close.
+    const float min_distance = 1e-3f;
+
+}
+
+
+// class LodCloud:
+LodCloud::LodCloud( const LodParams &params )
+: params_( params ), grid_bits_( 0 ), version_( 0 ), cleared_version_( 0 )
+{
+    if (params_.depth < 1 || params_.depth > 16)
+    {
+        throw std::invalid_argument( "LodCloud depth must be in [1, 16]" );
+    }
+
+    while (grid_bits_ < 6 && (1 << grid_bits_) < params_.grid) ++grid_bits_;
+    if (grid_bits_ < 2 || (1 << grid_bits_) != params_.grid)
+    {
+        throw std::invalid_argument( "LodCloud grid must be 4, 8, 16, 32 or 64" );
+    }
+
+    if (!(params_.size > 0.0f))
+    {
+        throw std::invalid_argument( "LodCloud size must be positive" );
+    }
+
+    const uint32_t origin[3] = { 0, 0, 0 };
+    addNode( -1, 0, origin );
+}
+
+
+void LodCloud::insert( const TangoPointCloud *cloud, const TangoPoseData *depth_pose )
+{
+    if (depth_pose->status_code != TANGO_POSE_VALID)
+    {
+        throw std::invalid_argument( "LodCloud::insert() requires a valid pose" );
+    }
+
+    insert( cloud, Pose_toTransform( depth_pose ) );
+}
+
+
+void LodCloud::insert( const TangoPointCloud *cloud, const Transform &depth_to_map )
+{
+    const auto start = std::chrono::steady_clock::now();
+    ++version_;
+
+        // Points are located by their integer coordinates in the grid cells of the deepest level.
+    const int depth = params_.depth;
+    const uint32_t cells = uint32_t( 1 ) << (grid_bits_ + depth - 1);
+    const uint32_t cell_mask = uint32_t( params_.grid - 1 );
+    const float limit = float( cells );
+    const float scale = limit/params_.size;
+    float origin[3];
+    for (int i = 0; i != 3; ++i) origin[i] = params_.center[i] - 0.5f*params_.size;
+
+    int64_t stored = 0;
+    for (uint32_t p = 0; p != cloud->num_points; ++p)
+    {
+        const float *point = cloud->points[p];
+        if (point[3] < params_.min_confidence) continue;
+
+        float xyz[3];
+        Transform_apply( depth_to_map, point, xyz );
+
+        uint32_t coords[3];
+        bool inside = true;
+        for (int i = 0; i != 3; ++i)
+        {
+            const float c = (xyz[i] - origin[i])*scale;
+            inside = inside && c >= 0.0f && c < limit;
+            coords[i] = inside ? uint32_t( c ) : 0;
+        }
+
+        if (!inside) continue;
+
+            // Descend until a node has a free cell for the point.
+        int32_t id = 0;
+        for (int level = 0; ; ++level)
+        {
+            const int shift = depth - 1 - level;
+            const uint32_t cell = ((coords[2] >> shift) & cell_mask) << (2*grid_bits_)
+                | ((coords[1] >> shift) & cell_mask) << grid_bits_
+                | ((coords[0] >> shift) & cell_mask);
+
+            uint64_t &word = nodes_[id].occupied[ cell >> 6 ];
+            const uint64_t bit = uint64_t( 1 ) << (cell & 63);
+            if (!(word & bit))
+            {
+                word |= bit;
+
+                Node &node = nodes_[id];
+                node.points.insert( node.points.end(), { xyz[0], xyz[1], xyz[2], point[3] } );
+                node.version = version_;
+
+                    // Ancestors of a node marked in this version are already marked.
+                for (int32_t a = id; a >= 0 && nodes_[a].subtree_version != version_; a = nodes_[a].parent)
+                {
+                    nodes_[a].subtree_version = version_;
+                }
+
+                ++stored;
+                break;
+            }
+
+            if (level + 1 == depth) break;
+
+            uint32_t child_coords[3];
+            int octant = 0;
+            for (int i = 0; i != 3; ++i)
+            {
+                child_coords[i] = coords[i] >> (grid_bits_ + shift - 1);
+                octant |= int( child_coords[i] & 1 ) << i;
+            }
+
+            int32_t child = nodes_[id].children[octant];
+            if (child < 0)
+            {
+                child = addNode( id, level + 1, child_coords );
+                nodes_[id].children[octant] = child;
+            }
+
+            id = child;
+        }
+    }
+
+    ++stats_.clouds;
+    stats_.points += cloud->num_points;
+    stats_.stored += stored;
+    stats_.seconds += std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+}
+
+
+void LodCloud::clear()
+{
+    ++version_;
+    cleared_version_ = version_;
+    nodes_.clear();
+
+    const uint32_t origin[3] = { 0, 0, 0 };
+    addNode( -1, 0, origin );
+}
+
+
+uint64_t LodCloud::version() const
+{
+    return version_;
+}
+
+
+uint64_t LodCloud::clearedVersion() const
+{
+    return cleared_version_;
+}
+
+
+int LodCloud::nodeCount() const
+{
+    return int( nodes_.size() );
+}
+
+
+LodNode LodCloud::node( int id ) const
+{
+    const Node &node = nodes_[id];
+
+    LodNode result;
+    result.parent = node.parent;
+    result.level = node.level;
+    result.size = params_.size/float( 1 << node.level );
+    result.spacing = result.size/float( params_.grid );
+    for (int i = 0; i != 3; ++i)
+    {
+        result.center[i] = params_.center[i] - 0.5f*params_.size + (float( node.coords[i] ) + 0.5f)*result.size;
+    }
+
+    result.points = node.points.data();
+    result.count = int( node.points.size()/4 );
+    result.version = node.version;
+    return result;
+}
+
+
+void LodCloud::changedSince( uint64_t version, std::vector< int > &result ) const
+{
+    if (nodes_[0].subtree_version <= version) return;
+
+        // Depth-first, so that parents precede their children.
+    std::vector< int32_t > stack( 1, 0 );
+    while (!stack.empty())
+    {
+        const Node &node = nodes_[ stack.back() ];
+        if (node.version > version) result.push_back( stack.back() );
+        stack.pop_back();
+
+        for (int octant = 7; octant >= 0; --octant)
+        {
+            const int32_t child = node.children[octant];
+            if (child >= 0 && nodes_[child].subtree_version > version) stack.push_back( child );
+        }
+    }
+}
+
+
+void LodCloud::select( const LodView &view, std::vector< int > &result ) const
+{
+        // A max-heap of candidates, by apparent size.
+    std::vector< std::pair< float, int32_t > > heap;
+    int points = 0;
+
+    auto consider = [&]( int32_t id )
+    {
+        const LodNode node = this->node( id );
+        const float radius = 0.5f*std::sqrt( 3.0f )*node.size;
+
+        for (int p = 0; p < view.plane_count; ++p)
+        {
+            const float *plane = view.planes[p];
+            const float d = plane[0]*node.center[0] + plane[1]*node.center[1] + plane[2]*node.center[2] + plane[3];
+            if (d < -radius) return;
+        }
+
+        const float offset[3] = {
+            node.center[0] - view.eye[0], node.center[1] - view.eye[1], node.center[2] - view.eye[2] };
+        const float distance = std::max(
+            std::sqrt( offset[0]*offset[0] + offset[1]*offset[1] + offset[2]*offset[2] ) - radius, min_distance );
+
+        heap.push_back( std::make_pair( node.size/distance, id ) );
+        std::push_heap( heap.begin(), heap.end() );
+    };
+
+    consider( 0 );
+    while (!heap.empty() && points < view.max_points)
+    {
+        std::pop_heap( heap.begin(), heap.end() );
+        const float apparent_size = heap.back().first;
+        const int32_t id = heap.back().second;
+        heap.pop_back();
+
+        const Node &node = nodes_[id];
+        result.push_back( id );
+        points += int( node.points.size()/4 );
+
+            // Refine, if the grid spacing appears too coarse.
+        if (apparent_size/float( params_.grid )*view.projection <= view.max_spacing) continue;
+
+        for (int32_t child: node.children)
+        {
+            if (child >= 0) consider( child );
+        }
+    }
+}
+
+
+const LodParams &LodCloud::params() const
+{
+    return params_;
+}
+
+
+const LodStats &LodCloud::stats() const
+{
+    return stats_;
+}
+
+
+int32_t LodCloud::addNode( int32_t parent, int level, const uint32_t *coords )
+{
+    const int cells = 1 << (3*grid_bits_);
+
+    nodes_.emplace_back();
+    Node &node = nodes_.back();
+    std::copy( coords, coords + 3, node.coords );
+    node.level = level;
+    node.parent = parent;
+    std::fill( node.children, node.children + 8, -1 );
+    node.version = 0;
+    node.subtree_version = 0;
+    node.occupied.assign( (cells + 63)/64, 0 );
+    return int32_t( nodes_.size() - 1 );
+}
+
+
+} // namespace boleo
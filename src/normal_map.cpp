@@ -0,0 +1,358 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Surface normal estimation on organized depth images.
+/*! @file
+
+    See normal_map.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/normal_map.hpp"
+#include "boleo/detail/features.hpp"
+#include "boleo/detail/parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+
+#if BOLEO_HAS_SSE2
+#   include <emmintrin.h>
+#elif BOLEO_HAS_NEON
+#   include <arm_neon.h>
+#endif
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Lane operations used by NormalSpan(), in scalar form.  Also used for the tail of each row.
+    struct ScalarOps
+    {
+        typedef float Vector;
+        typedef bool Mask;
+
+        static const int lanes = 1;
+
+        static Vector load( const float *p ) { return *p; }
+        static void store( float *p, Vector v ) { *p = v; }
+        static Vector set( float f ) { return f; }
+        static Vector add( Vector a, Vector b ) { return a + b; }
+        static Vector sub( Vector a, Vector b ) { return a - b; }
+        static Vector mul( Vector a, Vector b ) { return a*b; }
+        static Vector abs( Vector a ) { return std::fabs( a ); }
+        static Mask le( Vector a, Vector b ) { return a <= b; }
+        static Mask gt( Vector a, Vector b ) { return a > b; }
+        static Mask both( Mask a, Mask b ) { return a && b; }
+        static Vector select( Mask m, Vector a, Vector b ) { return m ? a : b; }
+        static Vector rsqrt( Vector a ) { return 1.0f/std::sqrt( a ); }
+    };
+
+
+#if BOLEO_HAS_SSE2
+    struct SimdOps
+    {
+        typedef __m128 Vector;
+        typedef __m128 Mask;
+
+        static const int lanes = 4;
+
+        static Vector load( const float *p ) { return _mm_loadu_ps( p ); }
+        static void store( float *p, Vector v ) { _mm_storeu_ps( p, v ); }
+        static Vector set( float f ) { return _mm_set1_ps( f ); }
+        static Vector add( Vector a, Vector b ) { return _mm_add_ps( a, b ); }
+        static Vector sub( Vector a, Vector b ) { return _mm_sub_ps( a, b ); }
+        static Vector mul( Vector a, Vector b ) { return _mm_mul_ps( a, b ); }
+        static Vector abs( Vector a ) { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+        static Mask le( Vector a, Vector b ) { return _mm_cmple_ps( a, b ); }
+        static Mask gt( Vector a, Vector b ) { return _mm_cmpgt_ps( a, b ); }
+        static Mask both( Mask a, Mask b ) { return _mm_and_ps( a, b ); }
+        static Vector select( Mask m, Vector a, Vector b )
+        {
+            return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) );
+        }
+
+            // The estimate is good to 12 bits.  A Newton-Raphson step brings it close to full precision.
+        static Vector rsqrt( Vector a )
+        {
+            const Vector r = _mm_rsqrt_ps( a );
+            const Vector half_a_r2 = _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5f ), a ), _mm_mul_ps( r, r ) );
+            return _mm_mul_ps( r, _mm_sub_ps( _mm_set1_ps( 1.5f ), half_a_r2 ) );
+        }
+    };
+#elif BOLEO_HAS_NEON
+    struct SimdOps
+    {
+        typedef float32x4_t Vector;
+        typedef uint32x4_t Mask;
+
+        static const int lanes = 4;
+
+        static Vector load( const float *p ) { return vld1q_f32( p ); }
+        static void store( float *p, Vector v ) { vst1q_f32( p, v ); }
+        static Vector set( float f ) { return vdupq_n_f32( f ); }
+        static Vector add( Vector a, Vector b ) { return vaddq_f32( a, b ); }
+        static Vector sub( Vector a, Vector b ) { return vsubq_f32( a, b ); }
+        static Vector mul( Vector a, Vector b ) { return vmulq_f32( a, b ); }
+        static Vector abs( Vector a ) { return vabsq_f32( a ); }
+        static Mask le( Vector a, Vector b ) { return vcleq_f32( a, b ); }
+        static Mask gt( Vector a, Vector b ) { return vcgtq_f32( a, b ); }
+        static Mask both( Mask a, Mask b ) { return vandq_u32( a, b ); }
+        static Vector select( Mask m, Vector a, Vector b ) { return vbslq_f32( m, a, b ); }
+
+            // The estimate is only good to 8 bits, so 2 Newton-Raphson steps are taken.
+        static Vector rsqrt( Vector a )
+        {
+            Vector r = vrsqrteq_f32( a );
+            r = vmulq_f32( r, vrsqrtsq_f32( vmulq_f32( a, r ), r ) );
+            return vmulq_f32( r, vrsqrtsq_f32( vmulq_f32( a, r ), r ) );
+        }
+    };
+#endif
+
+
+        // Inputs to NormalSpan(), for 1 row.
+    struct NormalRow
+    {
+        const float *center;    // Depth of the row.
+        const float *up;        // Depth of the row radius above.
+        const float *down;      // Depth of the row radius below.
+        const float *kx;        // (x - cx)/fx, per column.
+        float ky;               // (y - cy)/fy, of this row.
+        float ky_up;            // Same, of the row above.
+        float ky_down;          // Same, of the row below.
+        int radius;
+        float max_depth_change;
+    };
+
+
+        // Computes normals for columns [begin, end), in steps of ops_type::lanes.  Returns where it stopped.
+        /*
+            With P = (kx z, ky z, z), the normal is the cross product of P(x + r, y) - P(x - r, y) and
+            P(x, y + r) - P(x, y - r), which expand to:
+
+                a = (kx_right z_right - kx_left z_left, ky (z_right - z_left), z_right - z_left)
+                b = (kx (z_down - z_up), ky_down z_down - ky_up z_up, z_down - z_up)
+
+            It's flipped to face the camera, i.e. so that its dot product with (kx, ky, 1) is negative.
+        */
+    template< typename ops_type >
+    int NormalSpan( const NormalRow &row, int begin, int end, float *out_x, float *out_y, float *out_z )
+    {
+        typedef ops_type O;
+        typedef typename O::Vector V;
+        typedef typename O::Mask M;
+
+        const int r = row.radius;
+        const V threshold = O::set( row.max_depth_change );
+        const V ky = O::set( row.ky );
+        const V ky_up = O::set( row.ky_up );
+        const V ky_down = O::set( row.ky_down );
+        const V min_length2 = O::set( std::numeric_limits< float >::min() );
+        const V zero = O::set( 0.0f );
+        const V invalid = O::set( std::numeric_limits< float >::quiet_NaN() );
+
+        int x = begin;
+        for (; x + O::lanes <= end; x += O::lanes)
+        {
+            const V z = O::load( row.center + x );
+            const V z_left = O::load( row.center + x - r );
+            const V z_right = O::load( row.center + x + r );
+            const V z_up = O::load( row.up + x );
+            const V z_down = O::load( row.down + x );
+            const V kx = O::load( row.kx + x );
+            const V kx_left = O::load( row.kx + x - r );
+            const V kx_right = O::load( row.kx + x + r );
+
+                // Since the threshold is below 1, this also rejects neighbors without depth.
+            const V limit = O::mul( threshold, z );
+            M valid = O::both( O::gt( z, zero ), O::le( O::abs( O::sub( z_left, z ) ), limit ) );
+            valid = O::both( valid, O::le( O::abs( O::sub( z_right, z ) ), limit ) );
+            valid = O::both( valid, O::le( O::abs( O::sub( z_up, z ) ), limit ) );
+            valid = O::both( valid, O::le( O::abs( O::sub( z_down, z ) ), limit ) );
+
+            const V dz_x = O::sub( z_right, z_left );
+            const V dz_y = O::sub( z_down, z_up );
+            const V a0 = O::sub( O::mul( kx_right, z_right ), O::mul( kx_left, z_left ) );
+            const V a1 = O::mul( ky, dz_x );
+            const V b0 = O::mul( kx, dz_y );
+            const V b1 = O::sub( O::mul( ky_down, z_down ), O::mul( ky_up, z_up ) );
+
+            const V n0 = O::sub( O::mul( a1, dz_y ), O::mul( dz_x, b1 ) );
+            const V n1 = O::sub( O::mul( dz_x, b0 ), O::mul( a0, dz_y ) );
+            const V n2 = O::sub( O::mul( a0, b1 ), O::mul( a1, b0 ) );
+
+            const V length2 = O::add( O::add( O::mul( n0, n0 ), O::mul( n1, n1 ) ), O::mul( n2, n2 ) );
+            valid = O::both( valid, O::gt( length2, min_length2 ) );
+
+            const V facing = O::add( O::add( O::mul( n0, kx ), O::mul( n1, ky ) ), n2 );
+            const V inverse = O::rsqrt( O::select( valid, length2, O::set( 1.0f ) ) );
+            const V scale = O::select( O::gt( facing, zero ), O::sub( zero, inverse ), inverse );
+
+            O::store( out_x + x, O::select( valid, O::mul( n0, scale ), invalid ) );
+            O::store( out_y + x, O::select( valid, O::mul( n1, scale ), invalid ) );
+            O::store( out_z + x, O::select( valid, O::mul( n2, scale ), invalid ) );
+        }
+
+        return x;
+    }
+
+
+    void FillInvalid( float *begin, float *end )
+    {
+        std::fill( begin, end, std::numeric_limits< float >::quiet_NaN() );
+    }
+
+}
+
+
+// class NormalMap:
+NormalMap::NormalMap()
+: width_( 0 ), height_( 0 )
+{
+}
+
+
+void NormalMap::resize( int width, int height )
+{
+    if (width < 0 || height < 0) throw std::invalid_argument( "NormalMap dimensions must be non-negative" );
+
+    width_ = width;
+    height_ = height;
+
+    const size_t size = size_t( width )*height;
+    x_.resize( size );
+    y_.resize( size );
+    z_.resize( size );
+}
+
+
+int NormalMap::width() const
+{
+    return width_;
+}
+
+
+int NormalMap::height() const
+{
+    return height_;
+}
+
+
+float *NormalMap::x( int y )
+{
+    return x_.data() + size_t( y )*width_;
+}
+
+
+float *NormalMap::y( int y )
+{
+    return y_.data() + size_t( y )*width_;
+}
+
+
+float *NormalMap::z( int y )
+{
+    return z_.data() + size_t( y )*width_;
+}
+
+
+const float *NormalMap::x( int y ) const
+{
+    return x_.data() + size_t( y )*width_;
+}
+
+
+const float *NormalMap::y( int y ) const
+{
+    return y_.data() + size_t( y )*width_;
+}
+
+
+const float *NormalMap::z( int y ) const
+{
+    return z_.data() + size_t( y )*width_;
+}
+
+
+
+void DepthImage_normals( const DepthImage &depth, NormalMap &result, const NormalParams &params )
+{
+    if (params.radius < 1) throw std::invalid_argument( "Normal radius must be at least 1" );
+    if (!(params.max_depth_change > 0.0f && params.max_depth_change < 1.0f))
+    {
+        throw std::invalid_argument( "Normal max_depth_change must be in (0, 1)" );
+    }
+
+    const int width = depth.width();
+    const int height = depth.height();
+    const int r = params.radius;
+    result.resize( width, height );
+
+    const PinholeCamera &camera = depth.camera();
+    const float inverse_fx = 1.0f/camera.fx;
+    const float inverse_fy = 1.0f/camera.fy;
+
+    DepthImage::storage_type kx( width );
+    for (int x = 0; x < width; ++x) kx[x] = (float( x ) - camera.cx)*inverse_fx;
+
+    detail::ParallelFor( height, params.threads,
+        [&]( int, int begin, int end )
+        {
+            for (int y = begin; y < end; ++y)
+            {
+                float *out_x = result.x( y );
+                float *out_y = result.y( y );
+                float *out_z = result.z( y );
+
+                if (y < r || y >= height - r || width <= 2*r)
+                {
+                    FillInvalid( out_x, out_x + width );
+                    FillInvalid( out_y, out_y + width );
+                    FillInvalid( out_z, out_z + width );
+                    continue;
+                }
+
+                NormalRow row;
+                row.center = depth.row( y );
+                row.up = depth.row( y - r );
+                row.down = depth.row( y + r );
+                row.kx = kx.data();
+                row.ky = (float( y ) - camera.cy)*inverse_fy;
+                row.ky_up = (float( y - r ) - camera.cy)*inverse_fy;
+                row.ky_down = (float( y + r ) - camera.cy)*inverse_fy;
+                row.radius = r;
+                row.max_depth_change = params.max_depth_change;
+
+                int x = r;
+#if BOLEO_HAS_SSE2 || BOLEO_HAS_NEON
+                x = NormalSpan< SimdOps >( row, x, width - r, out_x, out_y, out_z );
+#endif
+                NormalSpan< ScalarOps >( row, x, width - r, out_x, out_y, out_z );
+
+                for (float *plane: { out_x, out_y, out_z })
+                {
+                    FillInvalid( plane, plane + r );
+                    FillInvalid( plane + width - r, plane + width );
+                }
+            }
+        } );
+}
+
+
+} // namespace boleo
@@ -0,0 +1,458 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Occupancy octree, fed by TangoPointCloud.
+/*! @file
+
+    See occupancy_map.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/occupancy_map.hpp"
+#include "boleo/detail/parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+    // Log-odds value marking nodes which have never been updated.
+constexpr float Unknown = -std::numeric_limits< float >::infinity();
+
+
+    // Spreads the low 21 bits of v, so there are 2 zero bits between each.
+uint64_t SpreadBits( uint64_t v )
+{
+    v &= UINT64_C( 0x1fffff );
+    v = (v | v << 32) & UINT64_C( 0x1f00000000ffff );
+    v = (v | v << 16) & UINT64_C( 0x1f0000ff0000ff );
+    v = (v | v << 8)  & UINT64_C( 0x100f00f00f00f00f );
+    v = (v | v << 4)  & UINT64_C( 0x10c30c30c30c30c3 );
+    v = (v | v << 2)  & UINT64_C( 0x1249249249249249 );
+    return v;
+}
+
+
+    // Inverse of SpreadBits().
+uint32_t CompactBits( uint64_t v )
+{
+    v &= UINT64_C( 0x1249249249249249 );
+    v = (v ^ (v >> 2))  & UINT64_C( 0x10c30c30c30c30c3 );
+    v = (v ^ (v >> 4))  & UINT64_C( 0x100f00f00f00f00f );
+    v = (v ^ (v >> 8))  & UINT64_C( 0x1f0000ff0000ff );
+    v = (v ^ (v >> 16)) & UINT64_C( 0x1f00000000ffff );
+    v = (v ^ (v >> 32)) & UINT64_C( 0x1fffff );
+    return uint32_t( v );
+}
+
+
+OccupancyKey EncodeKey( int x, int y, int z )
+{
+    return SpreadBits( x ) | SpreadBits( y ) << 1 | SpreadBits( z ) << 2;
+}
+
+
+    // Appends the keys of voxels traversed between two points, in voxel units.
+    /*
+        The voxel containing end is appended only if include_end is set.
+    */
+void TraceRay(
+    const float *begin, const float *end, int size, bool include_end,
+    std::vector< OccupancyKey > &keys )
+{
+    int cell[3], last[3], step[3];
+    float t_max[3], t_delta[3];
+
+    for (int i = 0; i != 3; ++i)
+    {
+        cell[i] = int( std::floor( begin[i] ) );
+        last[i] = int( std::floor( end[i] ) );
+
+        const float dir = end[i] - begin[i];
+        if (dir > 0.0f)
+        {
+            step[i] = 1;
+            t_delta[i] = 1.0f / dir;
+            t_max[i] = (float( cell[i] + 1 ) - begin[i]) * t_delta[i];
+        }
+        else if (dir < 0.0f)
+        {
+            step[i] = -1;
+            t_delta[i] = -1.0f / dir;
+            t_max[i] = (begin[i] - float( cell[i] )) * t_delta[i];
+        }
+        else
+        {
+            step[i] = 0;
+            t_delta[i] = std::numeric_limits< float >::infinity();
+            t_max[i] = std::numeric_limits< float >::infinity();
+        }
+    }
+
+        // Bounds the walk, in case rounding would otherwise overshoot last.
+    int steps = std::abs( last[0] - cell[0] )
+        + std::abs( last[1] - cell[1] )
+        + std::abs( last[2] - cell[2] );
+
+    for (;; --steps)
+    {
+        const bool at_end = steps <= 0
+            || (cell[0] == last[0] && cell[1] == last[1] && cell[2] == last[2]);
+
+        if (at_end && !include_end) return;
+
+        if (cell[0] >= 0 && cell[0] < size
+            && cell[1] >= 0 && cell[1] < size
+            && cell[2] >= 0 && cell[2] < size)
+        {
+            keys.push_back( EncodeKey( cell[0], cell[1], cell[2] ) );
+        }
+
+        if (at_end) return;
+
+        const int axis = t_max[0] < t_max[1]
+            ? (t_max[0] < t_max[2] ? 0 : 2)
+            : (t_max[1] < t_max[2] ? 1 : 2);
+
+        cell[axis] += step[axis];
+        t_max[axis] += t_delta[axis];
+    }
+}
+
+
+    // Sorts & removes duplicates, from the concatenation of several vectors.
+void Merge(
+    const std::vector< std::vector< OccupancyKey > > &parts,
+    std::vector< OccupancyKey > &merged )
+{
+    merged.clear();
+    for (const std::vector< OccupancyKey > &part: parts)
+    {
+        merged.insert( merged.end(), part.begin(), part.end() );
+    }
+
+    std::sort( merged.begin(), merged.end() );
+    merged.erase( std::unique( merged.begin(), merged.end() ), merged.end() );
+}
+
+} // namespace
+
+
+
+// class OccupancyMap:
+OccupancyMap::OccupancyMap( const OccupancyParams &params )
+: params_( params )
+{
+    if (params_.depth < 1 || params_.depth > 16)
+    {
+        throw std::invalid_argument( "OccupancyMap depth must be in [1, 16]" );
+    }
+
+    if (!(params_.resolution > 0.0f))
+    {
+        throw std::invalid_argument( "OccupancyMap resolution must be positive" );
+    }
+
+    pool_.reset( new detail::WorkerPool( params_.threads ) );
+    free_keys_.resize( pool_->size() );
+    hit_keys_.resize( pool_->size() );
+
+    clear();
+}
+
+
+OccupancyMap::~OccupancyMap()
+{
+}
+
+
+void OccupancyMap::insert( const TangoPointCloud *cloud, const TangoPoseData *depth_pose )
+{
+    if (depth_pose->status_code != TANGO_POSE_VALID)
+    {
+        throw std::invalid_argument( "OccupancyMap::insert() requires a valid pose" );
+    }
+
+    insert( cloud, Pose_toTransform( depth_pose ) );
+}
+
+
+void OccupancyMap::insert( const TangoPointCloud *cloud, const Transform &depth_to_map )
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    const int size = 1 << params_.depth;
+    const float offset = float( size / 2 );
+    const float inv_resolution = 1.0f / params_.resolution;
+    const float max_range = params_.max_range * inv_resolution;
+
+        // The sensor origin, in voxel units.
+    float origin[3];
+    for (int i = 0; i != 3; ++i)
+    {
+        origin[i] = depth_to_map.translation[i] * inv_resolution + offset;
+    }
+
+    const int num_points = int( cloud->num_points );
+    if (num_points == 0)
+    {
+        stats_.clouds += 1;
+        return;
+    }
+
+        // The pool may run fewer chunks than threads, so every buffer is cleared here, not in the chunks.
+    for (size_t i = 0; i != free_keys_.size(); ++i)
+    {
+        free_keys_[i].clear();
+        hit_keys_[i].clear();
+    }
+
+    pool_->run( num_points,
+        [&]( int chunk, int begin, int end )
+        {
+            std::vector< OccupancyKey > &free_keys = free_keys_[chunk];
+            std::vector< OccupancyKey > &hit_keys = hit_keys_[chunk];
+
+            for (int i = begin; i != end; ++i)
+            {
+                float point[3];
+                Transform_apply( depth_to_map, cloud->points[i], point );
+
+                float delta[3];
+                float range_sq = 0.0f;
+                for (int a = 0; a != 3; ++a)
+                {
+                    point[a] = point[a] * inv_resolution + offset;
+                    delta[a] = point[a] - origin[a];
+                    range_sq += delta[a]*delta[a];
+                }
+
+                    // Beyond max_range, the point isn't trusted as a hit.
+                const bool is_hit = range_sq <= max_range*max_range;
+                if (!is_hit)
+                {
+                    const float scale = max_range / std::sqrt( range_sq );
+                    for (int a = 0; a != 3; ++a) point[a] = origin[a] + delta[a]*scale;
+                }
+
+                TraceRay( origin, point, size, !is_hit, free_keys );
+
+                if (is_hit
+                    && point[0] >= 0.0f && point[0] < float( size )
+                    && point[1] >= 0.0f && point[1] < float( size )
+                    && point[2] >= 0.0f && point[2] < float( size ))
+                {
+                    hit_keys.push_back( EncodeKey(
+                        int( point[0] ), int( point[1] ), int( point[2] ) ) );
+                }
+            }
+        } );
+
+    Merge( free_keys_, merged_free_ );
+    Merge( hit_keys_, merged_hit_ );
+
+        // Each voxel is updated once, with hits taking precedence.
+    int64_t updates = 0;
+    auto hit = merged_hit_.begin();
+    for (OccupancyKey key: merged_free_)
+    {
+        while (hit != merged_hit_.end() && *hit < key) ++hit;
+        if (hit != merged_hit_.end() && *hit == key) continue;
+
+        if (update( key, params_.log_odds_miss )) changes_.push_back( key );
+        ++updates;
+    }
+
+    for (OccupancyKey key: merged_hit_)
+    {
+        if (update( key, params_.log_odds_hit )) changes_.push_back( key );
+        ++updates;
+    }
+
+    const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+    stats_.clouds += 1;
+    stats_.points += num_points;
+    stats_.voxel_updates += updates;
+    stats_.seconds += elapsed.count();
+}
+
+
+void OccupancyMap::clear()
+{
+    const Node root = { Unknown, -1 };
+    nodes_.clear();
+    nodes_.push_back( root );
+    changes_.clear();
+}
+
+
+bool OccupancyMap::coordToKey( const float *xyz, OccupancyKey &key ) const
+{
+    const int size = 1 << params_.depth;
+    int cell[3];
+    for (int i = 0; i != 3; ++i)
+    {
+        const float v = std::floor( xyz[i] / params_.resolution ) + float( size / 2 );
+        if (!(v >= 0.0f && v < float( size ))) return false;
+        cell[i] = int( v );
+    }
+
+    key = EncodeKey( cell[0], cell[1], cell[2] );
+    return true;
+}
+
+
+void OccupancyMap::keyToCoord( OccupancyKey key, float *xyz ) const
+{
+    const int half = (1 << params_.depth) / 2;
+    for (int i = 0; i != 3; ++i)
+    {
+        const int cell = int( CompactBits( key >> i ) );
+        xyz[i] = (float( cell - half ) + 0.5f) * params_.resolution;
+    }
+}
+
+
+float OccupancyMap::logOdds( OccupancyKey key ) const
+{
+    const int leaf = findLeaf( key );
+    if (leaf < 0 || nodes_[leaf].log_odds == Unknown) return 0.0f;
+
+    return nodes_[leaf].log_odds;
+}
+
+
+bool OccupancyMap::isKnown( OccupancyKey key ) const
+{
+    const int leaf = findLeaf( key );
+    return leaf >= 0 && nodes_[leaf].log_odds != Unknown;
+}
+
+
+bool OccupancyMap::isOccupied( OccupancyKey key ) const
+{
+    const int leaf = findLeaf( key );
+    return leaf >= 0 && nodes_[leaf].log_odds > params_.occupied;
+}
+
+
+std::vector< OccupancyKey > OccupancyMap::takeChanges()
+{
+    std::vector< OccupancyKey > result;
+    result.swap( changes_ );
+
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique( result.begin(), result.end() ), result.end() );
+
+    changes_.reserve( result.capacity() );
+    return result;
+}
+
+
+const OccupancyParams &OccupancyMap::params() const
+{
+    return params_;
+}
+
+
+const OccupancyStats &OccupancyMap::stats() const
+{
+    return stats_;
+}
+
+
+int OccupancyMap::nodeCount() const
+{
+    return int( nodes_.size() );
+}
+
+
+int OccupancyMap::findLeaf( OccupancyKey key ) const
+{
+    int index = 0;
+    for (int shift = 3*(params_.depth - 1); shift >= 0; shift -= 3)
+    {
+        const int32_t children = nodes_[index].children;
+        if (children < 0) return -1;
+
+        index = children + int( (key >> shift) & 7 );
+    }
+
+    return index;
+}
+
+
+bool OccupancyMap::update( OccupancyKey key, float delta )
+{
+        // Indices of the nodes visited, from the root down to the leaf.
+    int32_t path[17];
+    int levels = 0;
+
+    int32_t index = 0;
+    path[levels++] = index;
+    for (int shift = 3*(params_.depth - 1); shift >= 0; shift -= 3)
+    {
+        int32_t children = nodes_[index].children;
+        if (children < 0)
+        {
+            children = allocateChildren( Unknown );
+            nodes_[index].children = children;
+        }
+
+        index = children + int32_t( (key >> shift) & 7 );
+        path[levels++] = index;
+    }
+
+    Node &leaf = nodes_[index];
+    const float prior = leaf.log_odds == Unknown ? 0.0f : leaf.log_odds;
+    const float posterior =
+        std::min( std::max( prior + delta, params_.clamp_min ), params_.clamp_max );
+
+    if (leaf.log_odds == posterior) return false;
+    leaf.log_odds = posterior;
+
+        // Propagate the maximum upward, until an ancestor is unaffected.
+    for (int level = levels - 2; level >= 0; --level)
+    {
+        Node &node = nodes_[path[level]];
+        const Node *children = &nodes_[node.children];
+
+        float max = children[0].log_odds;
+        for (int c = 1; c != 8; ++c) max = std::max( max, children[c].log_odds );
+
+        if (node.log_odds == max) break;
+        node.log_odds = max;
+    }
+
+    return true;
+}
+
+
+int32_t OccupancyMap::allocateChildren( float log_odds )
+{
+    const Node child = { log_odds, -1 };
+    const int32_t first = int32_t( nodes_.size() );
+    nodes_.insert( nodes_.end(), 8, child );
+    return first;
+}
+
+
+} // namespace boleo
@@ -0,0 +1,479 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! RANSAC plane extraction, directly from TangoPointCloud.
+/*! @file
+
+    See plane_extractor.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/plane_extractor.hpp"
+#include "boleo/detail/features.hpp"
+#include "boleo/detail/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+
+#if BOLEO_HAS_SSE2
+#   include <emmintrin.h>
+#elif BOLEO_HAS_NEON
+#   include <arm_neon.h>
+#endif
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Points counted between checks for early termination.  Must be a multiple of 4.
+    const int count_block = 1024;
+
+
+        // Counts the points within distance of plane.
+        /*
+            Gives up, returning a count below target, once target can no longer be reached.  x, y & z must be
+            aligned for SIMD.
+        */
+    int CountInliers( const PointCloudSoA &points, const float *plane, float distance, int target )
+    {
+        const int n = points.size();
+        const float *x = points.x();
+        const float *y = points.y();
+        const float *z = points.z();
+
+        int count = 0;
+        for (int begin = 0; begin < n; begin += count_block)
+        {
+            if (count + (n - begin) < target) break;
+
+            const int end = std::min( begin + count_block, n );
+            int i = begin;
+#if BOLEO_HAS_SSE2
+            const __m128 a = _mm_set1_ps( plane[0] );
+            const __m128 b = _mm_set1_ps( plane[1] );
+            const __m128 c = _mm_set1_ps( plane[2] );
+            const __m128 d = _mm_set1_ps( plane[3] );
+            const __m128 limit = _mm_set1_ps( distance );
+            const __m128 sign = _mm_set1_ps( -0.0f );
+
+                // Each lane of a true comparison is -1, so subtracting it counts.
+            __m128i counts = _mm_setzero_si128();
+            for (; i + 4 <= end; i += 4)
+            {
+                __m128 e = _mm_add_ps( _mm_mul_ps( a, _mm_load_ps( x + i ) ), d );
+                e = _mm_add_ps( e, _mm_mul_ps( b, _mm_load_ps( y + i ) ) );
+                e = _mm_add_ps( e, _mm_mul_ps( c, _mm_load_ps( z + i ) ) );
+                const __m128 inside = _mm_cmple_ps( _mm_andnot_ps( sign, e ), limit );
+                counts = _mm_sub_epi32( counts, _mm_castps_si128( inside ) );
+            }
+
+            alignas( 16 ) int32_t lanes[4];
+            _mm_store_si128( reinterpret_cast< __m128i * >( lanes ), counts );
+            count += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif BOLEO_HAS_NEON
+            const float32x4_t d = vdupq_n_f32( plane[3] );
+            const float32x4_t limit = vdupq_n_f32( distance );
+
+            uint32x4_t counts = vdupq_n_u32( 0 );
+            for (; i + 4 <= end; i += 4)
+            {
+                float32x4_t e = vmlaq_n_f32( d, vld1q_f32( x + i ), plane[0] );
+                e = vmlaq_n_f32( e, vld1q_f32( y + i ), plane[1] );
+                e = vmlaq_n_f32( e, vld1q_f32( z + i ), plane[2] );
+                counts = vsubq_u32( counts, vcleq_f32( vabsq_f32( e ), limit ) );
+            }
+
+            count += int( vgetq_lane_u32( counts, 0 ) + vgetq_lane_u32( counts, 1 )
+                + vgetq_lane_u32( counts, 2 ) + vgetq_lane_u32( counts, 3 ) );
+#endif
+            for (; i < end; ++i)
+            {
+                const float e = plane[0]*x[i] + plane[1]*y[i] + plane[2]*z[i] + plane[3];
+                if (std::fabs( e ) <= distance) ++count;
+            }
+        }
+
+        return count;
+    }
+
+
+        // Makes plane face the sensor (i.e. the origin).
+    void Orient( float *plane )
+    {
+        if (plane[3] < 0.0f)
+        {
+            for (int i = 0; i < 4; ++i) plane[i] = -plane[i];
+        }
+    }
+
+
+        // Computes the plane through points a, b & c.  Returns false if they're (nearly) collinear.
+    bool PlaneThrough( const PointCloudSoA &points, int a, int b, int c, float *plane )
+    {
+        const float *x = points.x();
+        const float *y = points.y();
+        const float *z = points.z();
+
+        const float u[3] = { x[b] - x[a], y[b] - y[a], z[b] - z[a] };
+        const float v[3] = { x[c] - x[a], y[c] - y[a], z[c] - z[a] };
+        const float n[3] = { u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0] };
+
+        const float length2 = n[0]*n[0] + n[1]*n[1] + n[2]*n[2];
+        if (!(length2 > 1e-12f)) return false;
+
+        const float scale = 1.0f/std::sqrt( length2 );
+        for (int i = 0; i < 3; ++i) plane[i] = n[i]*scale;
+        plane[3] = -(plane[0]*x[a] + plane[1]*y[a] + plane[2]*z[a]);
+        Orient( plane );
+        return true;
+    }
+
+
+        // A well-mixed hash (from SplitMix64), so each hypothesis' sample depends only on the seed & its index.
+    uint64_t Mix( uint64_t v )
+    {
+        v += 0x9e3779b97f4a7c15ull;
+        v = (v ^ (v >> 30))*0xbf58476d1ce4e5b9ull;
+        v = (v ^ (v >> 27))*0x94d049bb133111ebull;
+        return v ^ (v >> 31);
+    }
+
+
+        // Hypotheses needed to draw an all-inlier sample with the given probability, per the inlier ratio.
+    int RequiredHypotheses( int inliers, int points, float probability, int max_hypotheses )
+    {
+        const double ratio = double( inliers )/double( points );
+        const double all_inliers = ratio*ratio*ratio;
+        if (all_inliers >= 1.0) return 1;
+        if (all_inliers <= 0.0) return max_hypotheses;
+
+        const double required = std::ceil( std::log( 1.0 - probability )/std::log( 1.0 - all_inliers ) );
+        return required < double( max_hypotheses ) ? std::max( int( required ), 1 ) : max_hypotheses;
+    }
+
+
+        // Finds the eigenvector of the smallest eigenvalue of symmetric m, by Jacobi rotations.
+    void SmallestEigenvector( double m[3][3], double *result )
+    {
+        double v[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+        for (int sweep = 0; sweep < 16; ++sweep)
+        {
+            const double off = m[0][1]*m[0][1] + m[0][2]*m[0][2] + m[1][2]*m[1][2];
+            if (!(off > 1e-30)) break;
+
+            for (int p = 0; p < 2; ++p)
+            {
+                for (int q = p + 1; q < 3; ++q)
+                {
+                    if (m[p][q] == 0.0) continue;
+
+                    const double theta = (m[q][q] - m[p][p])/(2.0*m[p][q]);
+                    const double t = (theta >= 0.0 ? 1.0 : -1.0)/(std::fabs( theta ) + std::sqrt( theta*theta + 1.0 ));
+                    const double c = 1.0/std::sqrt( t*t + 1.0 );
+                    const double s = t*c;
+
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const double mkp = m[k][p];
+                        const double mkq = m[k][q];
+                        m[k][p] = c*mkp - s*mkq;
+                        m[k][q] = s*mkp + c*mkq;
+                    }
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const double mpk = m[p][k];
+                        const double mqk = m[q][k];
+                        m[p][k] = c*mpk - s*mqk;
+                        m[q][k] = s*mpk + c*mqk;
+                    }
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const double vkp = v[k][p];
+                        const double vkq = v[k][q];
+                        v[k][p] = c*vkp - s*vkq;
+                        v[k][q] = s*vkp + c*vkq;
+                    }
+                }
+            }
+        }
+
+        int smallest = 0;
+        for (int i = 1; i < 3; ++i)
+        {
+            if (m[i][i] < m[smallest][smallest]) smallest = i;
+        }
+
+        for (int k = 0; k < 3; ++k) result[k] = v[k][smallest];
+    }
+
+
+        // Least-squares fit of a plane to the points within distance of plane.  Returns false if degenerate.
+    bool Refit( const PointCloudSoA &points, const float *plane, float distance, float *result )
+    {
+        const int n = points.size();
+        const float *x = points.x();
+        const float *y = points.y();
+        const float *z = points.z();
+
+        double sum[3] = {};
+        double products[6] = {};
+        int count = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            const float e = plane[0]*x[i] + plane[1]*y[i] + plane[2]*z[i] + plane[3];
+            if (!(std::fabs( e ) <= distance)) continue;
+
+            const double p[3] = { x[i], y[i], z[i] };
+            for (int k = 0; k < 3; ++k) sum[k] += p[k];
+            products[0] += p[0]*p[0];
+            products[1] += p[0]*p[1];
+            products[2] += p[0]*p[2];
+            products[3] += p[1]*p[1];
+            products[4] += p[1]*p[2];
+            products[5] += p[2]*p[2];
+            ++count;
+        }
+
+        if (count < 3) return false;
+
+        const double mean[3] = { sum[0]/count, sum[1]/count, sum[2]/count };
+        double covariance[3][3];
+        covariance[0][0] = products[0]/count - mean[0]*mean[0];
+        covariance[0][1] = covariance[1][0] = products[1]/count - mean[0]*mean[1];
+        covariance[0][2] = covariance[2][0] = products[2]/count - mean[0]*mean[2];
+        covariance[1][1] = products[3]/count - mean[1]*mean[1];
+        covariance[1][2] = covariance[2][1] = products[4]/count - mean[1]*mean[2];
+        covariance[2][2] = products[5]/count - mean[2]*mean[2];
+
+        double normal[3];
+        SmallestEigenvector( covariance, normal );
+
+        const double length = std::sqrt( normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2] );
+        if (!(length > 0.0)) return false;
+
+        for (int k = 0; k < 3; ++k) result[k] = float( normal[k]/length );
+        result[3] = -float( (normal[0]*mean[0] + normal[1]*mean[1] + normal[2]*mean[2])/length );
+        Orient( result );
+        return true;
+    }
+
+}
+
+
+// class PlaneExtractor:
+PlaneExtractor::PlaneExtractor( const PlaneParams &params )
+: params_( params )
+{
+    if (params.max_planes < 1) throw std::invalid_argument( "PlaneParams::max_planes must be at least 1" );
+    if (!(params.distance > 0.0f)) throw std::invalid_argument( "PlaneParams::distance must be positive" );
+    if (params.min_inliers < 3) throw std::invalid_argument( "PlaneParams::min_inliers must be at least 3" );
+    if (params.max_hypotheses < 1) throw std::invalid_argument( "PlaneParams::max_hypotheses must be at least 1" );
+    if (!(params.probability > 0.0f && params.probability < 1.0f))
+    {
+        throw std::invalid_argument( "PlaneParams::probability must be in (0, 1)" );
+    }
+}
+
+
+int PlaneExtractor::extract( const TangoPointCloud *cloud )
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    PointCloud_toSoA( cloud, points_ );
+    remaining_.resize( points_.size() );
+    for (int i = 0; i < points_.size(); ++i) remaining_[i] = i;
+
+    inliers_.clear();
+    offsets_.clear();
+    planes_.clear();
+
+        // Drop low-confidence points, before searching.
+    if (params_.min_confidence > 0.0f)
+    {
+        int kept = 0;
+        const float *confidence = points_.confidence();
+        for (int i = 0; i < points_.size(); ++i)
+        {
+            if (!(confidence[i] >= params_.min_confidence)) continue;
+
+            points_.x()[kept] = points_.x()[i];
+            points_.y()[kept] = points_.y()[i];
+            points_.z()[kept] = points_.z()[i];
+            points_.confidence()[kept] = confidence[i];
+            remaining_[kept] = remaining_[i];
+            ++kept;
+        }
+
+        points_.resize( kept );
+        remaining_.resize( kept );
+    }
+
+    const int threads = detail::ThreadCount( params_.threads );
+    int64_t hypotheses = 0;
+
+    while (int( planes_.size() ) < params_.max_planes && points_.size() >= params_.min_inliers)
+    {
+        const int n = points_.size();
+        const uint64_t seed = (uint64_t( params_.seed ) << 32) ^ (uint64_t( planes_.size() ) << 24);
+
+        std::atomic< int > next( 0 );
+        std::atomic< int > limit( params_.max_hypotheses );
+        std::atomic< int > best_count( 0 );
+        std::atomic< int > evaluated( 0 );
+        std::mutex mutex;
+        int best_index = -1;
+        float best_plane[4] = {};
+
+        detail::ParallelFor( threads, threads,
+            [&]( int, int, int )
+            {
+                for (;;)
+                {
+                    const int h = next.fetch_add( 1 );
+                    if (h >= limit.load()) break;
+
+                    evaluated.fetch_add( 1, std::memory_order_relaxed );
+
+                    uint64_t state = Mix( seed ^ uint64_t( h ) );
+                    const int a = int( state % uint64_t( n ) );
+                    state = Mix( state );
+                    const int b = int( state % uint64_t( n ) );
+                    state = Mix( state );
+                    const int c = int( state % uint64_t( n ) );
+
+                    float plane[4];
+                    if (a == b || b == c || a == c || !PlaneThrough( points_, a, b, c, plane )) continue;
+
+                        // Ties with the best must reach the locked comparison, so that the lower hypothesis wins
+                        //  regardless of which was counted first.  The adaptive limit still depends on the order
+                        //  in which bests are found, so results are reproducible only with 1 thread.
+                    const int target = best_count.load( std::memory_order_relaxed );
+                    const int count = CountInliers( points_, plane, params_.distance, target );
+                    if (count < target) continue;
+
+                    std::lock_guard< std::mutex > lock( mutex );
+                    const int best = best_count.load();
+                    if (count > best || (count == best && h < best_index))
+                    {
+                        best_count.store( count );
+                        best_index = h;
+                        std::copy( plane, plane + 4, best_plane );
+                        limit.store( std::min(
+                            limit.load(),
+                            RequiredHypotheses( count, n, params_.probability, params_.max_hypotheses ) ) );
+                    }
+                }
+            } );
+
+        hypotheses += evaluated.load();
+        if (best_count.load() < params_.min_inliers) break;
+
+        float refined[4];
+        if (Refit( points_, best_plane, params_.distance, refined )
+            && CountInliers( points_, refined, params_.distance, 0 ) >= best_count.load())
+        {
+            std::copy( refined, refined + 4, best_plane );
+        }
+
+        Plane plane;
+        std::copy( best_plane, best_plane + 4, plane.coefficients );
+        plane.hypotheses = evaluated.load();
+        offsets_.push_back( int( inliers_.size() ) );
+        plane.inliers = partition( best_plane );
+        planes_.push_back( plane );
+    }
+
+    ++stats_.clouds;
+    stats_.points += cloud->num_points;
+    stats_.hypotheses += hypotheses;
+    stats_.seconds += std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    return int( planes_.size() );
+}
+
+
+int PlaneExtractor::partition( const float *plane )
+{
+    const int n = points_.size();
+    float *x = points_.x();
+    float *y = points_.y();
+    float *z = points_.z();
+    float *confidence = points_.confidence();
+
+    int kept = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const float e = plane[0]*x[i] + plane[1]*y[i] + plane[2]*z[i] + plane[3];
+        if (std::fabs( e ) <= params_.distance)
+        {
+            inliers_.push_back( remaining_[i] );
+            continue;
+        }
+
+        x[kept] = x[i];
+        y[kept] = y[i];
+        z[kept] = z[i];
+        confidence[kept] = confidence[i];
+        remaining_[kept] = remaining_[i];
+        ++kept;
+    }
+
+    points_.resize( kept );
+    remaining_.resize( kept );
+    return n - kept;
+}
+
+
+int PlaneExtractor::size() const
+{
+    return int( planes_.size() );
+}
+
+
+const Plane &PlaneExtractor::plane( int i ) const
+{
+    return planes_[i];
+}
+
+
+const int *PlaneExtractor::inliers( int i ) const
+{
+    return inliers_.data() + offsets_[i];
+}
+
+
+const std::vector< int > &PlaneExtractor::remaining() const
+{
+    return remaining_;
+}
+
+
+const PlaneParams &PlaneExtractor::params() const
+{
+    return params_;
+}
+
+
+const PlaneStats &PlaneExtractor::stats() const
+{
+    return stats_;
+}
+
+
+} // namespace boleo
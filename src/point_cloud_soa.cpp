@@ -0,0 +1,276 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Structure-of-arrays point cloud container.
+/*! @file
+
+    See point_cloud_soa.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/point_cloud_soa.hpp"
+#include "boleo/detail/common.hpp"
+
+#include <algorithm>
+
+#if BOLEO_HAS_SSE2
+#   include <emmintrin.h>
+#elif BOLEO_HAS_NEON
+#   include <arm_neon.h>
+#endif
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+    // Partial sums are flushed to double precision at this interval.
+constexpr int CentroidBlock = 1024;
+
+} // namespace
+
+
+
+// class PointCloudSoA:
+PointCloudSoA::PointCloudSoA()
+{
+}
+
+
+PointCloudSoA::PointCloudSoA( int size )
+{
+    resize( size );
+}
+
+
+void PointCloudSoA::resize( int size )
+{
+    x_.resize( size );
+    y_.resize( size );
+    z_.resize( size );
+    confidence_.resize( size );
+}
+
+
+void PointCloudSoA::reserve( int size )
+{
+    x_.reserve( size );
+    y_.reserve( size );
+    z_.reserve( size );
+    confidence_.reserve( size );
+}
+
+
+int PointCloudSoA::size() const
+{
+    return int( x_.size() );
+}
+
+
+bool PointCloudSoA::empty() const
+{
+    return x_.empty();
+}
+
+
+void PointCloudSoA::push_back( float x, float y, float z, float confidence )
+{
+    x_.push_back( x );
+    y_.push_back( y );
+    z_.push_back( z );
+    confidence_.push_back( confidence );
+}
+
+
+float *PointCloudSoA::x()           { return x_.data(); }
+float *PointCloudSoA::y()           { return y_.data(); }
+float *PointCloudSoA::z()           { return z_.data(); }
+float *PointCloudSoA::confidence()  { return confidence_.data(); }
+
+const float *PointCloudSoA::x() const           { return x_.data(); }
+const float *PointCloudSoA::y() const           { return y_.data(); }
+const float *PointCloudSoA::z() const           { return z_.data(); }
+const float *PointCloudSoA::confidence() const  { return confidence_.data(); }
+
+
+
+void PointCloud_toSoA( const TangoPointCloud *cloud, PointCloudSoA &result )
+{
+    const int n = int( cloud->num_points );
+    result.resize( n );
+    if (n == 0) return;
+
+    const float * BOLEO_RESTRICT in = cloud->points[0];
+    float * BOLEO_RESTRICT x = result.x();
+    float * BOLEO_RESTRICT y = result.y();
+    float * BOLEO_RESTRICT z = result.z();
+    float * BOLEO_RESTRICT c = result.confidence();
+
+    int i = 0;
+
+#if BOLEO_HAS_SSE2
+        // Channels are aligned, so 4-point groups can use aligned stores.
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 p0 = _mm_loadu_ps( in + 4*i );
+        __m128 p1 = _mm_loadu_ps( in + 4*i + 4 );
+        __m128 p2 = _mm_loadu_ps( in + 4*i + 8 );
+        __m128 p3 = _mm_loadu_ps( in + 4*i + 12 );
+        _MM_TRANSPOSE4_PS( p0, p1, p2, p3 );
+        _mm_store_ps( x + i, p0 );
+        _mm_store_ps( y + i, p1 );
+        _mm_store_ps( z + i, p2 );
+        _mm_store_ps( c + i, p3 );
+    }
+#elif BOLEO_HAS_NEON
+    for (; i + 4 <= n; i += 4)
+    {
+        const float32x4x4_t p = vld4q_f32( in + 4*i );
+        vst1q_f32( x + i, p.val[0] );
+        vst1q_f32( y + i, p.val[1] );
+        vst1q_f32( z + i, p.val[2] );
+        vst1q_f32( c + i, p.val[3] );
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        x[i] = in[4*i];
+        y[i] = in[4*i + 1];
+        z[i] = in[4*i + 2];
+        c[i] = in[4*i + 3];
+    }
+}
+
+
+void PointCloudSoA_bounds( const PointCloudSoA &cloud, float *min, float *max )
+{
+    const int n = cloud.size();
+    const float *channels[3] = { cloud.x(), cloud.y(), cloud.z() };
+
+    for (int axis = 0; axis != 3; ++axis)
+    {
+        const float * BOLEO_RESTRICT v = channels[axis];
+        float lo = v[0];
+        float hi = v[0];
+        int i = 0;
+
+#if BOLEO_HAS_SSE2
+        if (n >= 4)
+        {
+            __m128 vlo = _mm_load_ps( v );
+            __m128 vhi = vlo;
+            for (i = 4; i + 4 <= n; i += 4)
+            {
+                const __m128 p = _mm_load_ps( v + i );
+                vlo = _mm_min_ps( vlo, p );
+                vhi = _mm_max_ps( vhi, p );
+            }
+
+            float l[4], h[4];
+            _mm_storeu_ps( l, vlo );
+            _mm_storeu_ps( h, vhi );
+            lo = std::min( std::min( l[0], l[1] ), std::min( l[2], l[3] ) );
+            hi = std::max( std::max( h[0], h[1] ), std::max( h[2], h[3] ) );
+        }
+#elif BOLEO_HAS_NEON
+        if (n >= 4)
+        {
+            float32x4_t vlo = vld1q_f32( v );
+            float32x4_t vhi = vlo;
+            for (i = 4; i + 4 <= n; i += 4)
+            {
+                const float32x4_t p = vld1q_f32( v + i );
+                vlo = vminq_f32( vlo, p );
+                vhi = vmaxq_f32( vhi, p );
+            }
+
+            float32x2_t l = vpmin_f32( vget_low_f32( vlo ), vget_high_f32( vlo ) );
+            float32x2_t h = vpmax_f32( vget_low_f32( vhi ), vget_high_f32( vhi ) );
+            lo = std::min( vget_lane_f32( l, 0 ), vget_lane_f32( l, 1 ) );
+            hi = std::max( vget_lane_f32( h, 0 ), vget_lane_f32( h, 1 ) );
+        }
+#endif
+
+        for (; i < n; ++i)
+        {
+            lo = std::min( lo, v[i] );
+            hi = std::max( hi, v[i] );
+        }
+
+        min[axis] = lo;
+        max[axis] = hi;
+    }
+}
+
+
+void PointCloudSoA_centroid( const PointCloudSoA &cloud, float *centroid )
+{
+    const int n = cloud.size();
+    const float *channels[3] = { cloud.x(), cloud.y(), cloud.z() };
+
+    for (int axis = 0; axis != 3; ++axis)
+    {
+        const float * BOLEO_RESTRICT v = channels[axis];
+        double total = 0.0;
+
+        for (int begin = 0; begin < n; begin += CentroidBlock)
+        {
+            const int end = std::min( begin + CentroidBlock, n );
+
+                // 4 independent lanes, which the compiler can vectorize.
+            float lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            int i = begin;
+            for (; i + 4 <= end; i += 4)
+            {
+                for (int l = 0; l != 4; ++l) lanes[l] += v[i + l];
+            }
+
+            for (; i < end; ++i) lanes[0] += v[i];
+
+            total += double( lanes[0] ) + lanes[1] + lanes[2] + lanes[3];
+        }
+
+        centroid[axis] = float( total / n );
+    }
+}
+
+
+void PointCloudSoA_distanceSq(
+    const PointCloudSoA &cloud, const float *reference, PointCloudSoA::channel_type &result )
+{
+    const int n = cloud.size();
+    result.resize( n );
+
+    const float * BOLEO_RESTRICT x = cloud.x();
+    const float * BOLEO_RESTRICT y = cloud.y();
+    const float * BOLEO_RESTRICT z = cloud.z();
+    float * BOLEO_RESTRICT out = result.data();
+
+    const float rx = reference[0];
+    const float ry = reference[1];
+    const float rz = reference[2];
+
+    for (int i = 0; i < n; ++i)
+    {
+        const float dx = x[i] - rx;
+        const float dy = y[i] - ry;
+        const float dz = z[i] - rz;
+        out[i] = dx*dx + dy*dy + dz*dz;
+    }
+}
+
+
+} // namespace boleo
@@ -0,0 +1,485 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Frame-to-frame ICP registration of Tango point clouds.
+/*! @file
+
+    See registration.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/registration.hpp"
+#include "boleo/detail/features.hpp"
+#include "boleo/detail/parallel.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if BOLEO_HAS_SSE2
+#   include <emmintrin.h>
+#elif BOLEO_HAS_NEON
+#   include <arm_neon.h>
+#endif
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Rows of the accumulated outer product: 6 of the Jacobian, plus the residual.
+    const int sum_rows = 7;
+
+    typedef double Totals[sum_rows][8];
+
+
+        // Sum of J J^T, where J = (Jacobian, residual, 0).  Rows 0-5 hold the normal matrix & its
+        //  right-hand side (column 6), while [6][6] holds the squared error.
+    struct Sums
+    {
+        Totals totals;
+        int count;
+    };
+
+
+        // Accumulates the outer products of 1 image row, in single precision SIMD lanes.  These are
+        //  flushed to double precision per row, which keeps rounding error in check.
+    class RowSums
+    {
+    public:
+        RowSums()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+#if BOLEO_HAS_SSE2
+            for (int i = 0; i < sum_rows; ++i) lo_[i] = hi_[i] = _mm_setzero_ps();
+#elif BOLEO_HAS_NEON
+            for (int i = 0; i < sum_rows; ++i) lo_[i] = hi_[i] = vdupq_n_f32( 0.0f );
+#else
+            std::memset( sums_, 0, sizeof sums_ );
+#endif
+        }
+
+            // j must be 16-byte aligned.
+        void add( const float *j )
+        {
+#if BOLEO_HAS_SSE2
+            const __m128 j_lo = _mm_load_ps( j );
+            const __m128 j_hi = _mm_load_ps( j + 4 );
+            for (int i = 0; i < sum_rows; ++i)
+            {
+                const __m128 s = _mm_set1_ps( j[i] );
+                lo_[i] = _mm_add_ps( lo_[i], _mm_mul_ps( s, j_lo ) );
+                hi_[i] = _mm_add_ps( hi_[i], _mm_mul_ps( s, j_hi ) );
+            }
+#elif BOLEO_HAS_NEON
+            const float32x4_t j_lo = vld1q_f32( j );
+            const float32x4_t j_hi = vld1q_f32( j + 4 );
+            for (int i = 0; i < sum_rows; ++i)
+            {
+                lo_[i] = vmlaq_n_f32( lo_[i], j_lo, j[i] );
+                hi_[i] = vmlaq_n_f32( hi_[i], j_hi, j[i] );
+            }
+#else
+            for (int i = 0; i < sum_rows; ++i)
+            {
+                for (int k = 0; k < 8; ++k) sums_[i][k] += j[i]*j[k];
+            }
+#endif
+        }
+
+        void flush( Totals &totals )
+        {
+            alignas( 16 ) float row[8];
+            for (int i = 0; i < sum_rows; ++i)
+            {
+#if BOLEO_HAS_SSE2
+                _mm_store_ps( row, lo_[i] );
+                _mm_store_ps( row + 4, hi_[i] );
+#elif BOLEO_HAS_NEON
+                vst1q_f32( row, lo_[i] );
+                vst1q_f32( row + 4, hi_[i] );
+#else
+                std::memcpy( row, sums_[i], sizeof row );
+#endif
+                for (int k = 0; k < 8; ++k) totals[i][k] += row[k];
+            }
+
+            clear();
+        }
+
+    private:
+#if BOLEO_HAS_SSE2
+        __m128 lo_[sum_rows];
+        __m128 hi_[sum_rows];
+#elif BOLEO_HAS_NEON
+        float32x4_t lo_[sum_rows];
+        float32x4_t hi_[sum_rows];
+#else
+        float sums_[sum_rows][8];
+#endif
+    };
+
+
+    inline bool IsZero( const float *v )
+    {
+        return v[0] == 0.0f && v[1] == 0.0f && v[2] == 0.0f;
+    }
+
+
+    inline float Dot( const float *a, const float *b )
+    {
+        return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+    }
+
+
+    inline void Rotate( const Transform &t, const float *in, float *out )
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            out[r] = t.rotation[r][0]*in[0] + t.rotation[r][1]*in[1] + t.rotation[r][2]*in[2];
+        }
+    }
+
+
+    void ComputeVertices( const DepthImage &depth, detail::WorkerPool &pool, std::vector< float > &vertices )
+    {
+        const int width = depth.width();
+        const PinholeCamera &camera = depth.camera();
+        const float inverse_fx = 1.0f/camera.fx;
+        const float inverse_fy = 1.0f/camera.fy;
+
+        vertices.resize( 3*size_t( width )*depth.height() );
+        pool.run( depth.height(),
+            [&]( int, int begin, int end )
+            {
+                for (int y = begin; y < end; ++y)
+                {
+                    const float *row = depth.row( y );
+                    float *out = &vertices[ 3*size_t( y )*width ];
+                    const float dy = (float( y ) - camera.cy)*inverse_fy;
+                    for (int x = 0; x < width; ++x, out += 3)
+                    {
+                        const float z = row[x];
+                        out[0] = (float( x ) - camera.cx)*inverse_fx*z;
+                        out[1] = dy*z;
+                        out[2] = z;
+                    }
+                }
+            } );
+    }
+
+
+        // Normals from the cross product of central differences, oriented toward the camera.
+    void ComputeNormals(
+        int width, int height, detail::WorkerPool &pool, const std::vector< float > &vertices,
+        std::vector< float > &normals )
+    {
+        normals.assign( vertices.size(), 0.0f );
+        pool.run( height - 2,
+            [&]( int, int begin, int end )
+            {
+                for (int y = begin + 1; y < end + 1; ++y)
+                {
+                    for (int x = 1; x + 1 < width; ++x)
+                    {
+                        const size_t i = size_t( y )*width + x;
+                        const float *left = &vertices[ 3*(i - 1) ];
+                        const float *right = &vertices[ 3*(i + 1) ];
+                        const float *up = &vertices[ 3*(i - width) ];
+                        const float *down = &vertices[ 3*(i + width) ];
+                        if (left[2] == 0.0f || right[2] == 0.0f || up[2] == 0.0f || down[2] == 0.0f) continue;
+
+                        const float a[3] = { right[0] - left[0], right[1] - left[1], right[2] - left[2] };
+                        const float b[3] = { down[0] - up[0], down[1] - up[1], down[2] - up[2] };
+                        const float n[3] = { a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0] };
+
+                        const float length = std::sqrt( Dot( n, n ) );
+                        if (!(length > 0.0f)) continue;
+
+                        const float scale = Dot( n, &vertices[ 3*i ] ) > 0.0f ? -1.0f/length : 1.0f/length;
+                        float *out = &normals[ 3*i ];
+                        for (int c = 0; c < 3; ++c) out[c] = n[c]*scale;
+                    }
+                }
+            } );
+    }
+
+
+        // Solves A x = b, for symmetric positive-definite A, via Cholesky decomposition.
+    bool Solve6( const Totals &totals, double *x )
+    {
+        double l[6][6] = {};
+        for (int i = 0; i < 6; ++i)
+        {
+            for (int j = 0; j <= i; ++j)
+            {
+                double sum = totals[i][j];
+                for (int k = 0; k < j; ++k) sum -= l[i][k]*l[j][k];
+
+                if (i == j)
+                {
+                    if (!(sum > 1e-12)) return false;
+                    l[i][i] = std::sqrt( sum );
+                }
+                else l[i][j] = sum/l[j][j];
+            }
+        }
+
+            // Right-hand side is -J^T e.
+        double y[6];
+        for (int i = 0; i < 6; ++i)
+        {
+            double sum = -totals[i][6];
+            for (int k = 0; k < i; ++k) sum -= l[i][k]*y[k];
+            y[i] = sum/l[i][i];
+        }
+
+        for (int i = 5; i >= 0; --i)
+        {
+            double sum = y[i];
+            for (int k = i + 1; k < 6; ++k) sum -= l[k][i]*x[k];
+            x[i] = sum/l[i][i];
+        }
+
+        return true;
+    }
+
+
+        // Converts a twist (rotation vector, translation) to a Transform, via Rodrigues' formula.
+    Transform TwistToTransform( const double *xi )
+    {
+        const double theta = std::sqrt( xi[0]*xi[0] + xi[1]*xi[1] + xi[2]*xi[2] );
+        double k[3] = { xi[0], xi[1], xi[2] };
+        double s = 1.0;
+        double c = 0.0;
+        if (theta > 1e-12)
+        {
+            for (double &v: k) v /= theta;
+            s = std::sin( theta );
+            c = 1.0 - std::cos( theta );
+        }
+
+        const double kx[3][3] = { { 0, -k[2], k[1] }, { k[2], 0, -k[0] }, { -k[1], k[0], 0 } };
+
+        Transform result;
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int col = 0; col < 3; ++col)
+            {
+                double kx2 = 0.0;
+                for (int m = 0; m < 3; ++m) kx2 += kx[r][m]*kx[m][col];
+                result.rotation[r][col] = float( (r == col ? 1.0 : 0.0) + s*kx[r][col] + c*kx2 );
+            }
+
+            result.translation[r] = float( xi[3 + r] );
+        }
+
+        return result;
+    }
+
+
+        // Accumulates the point-to-plane normal equations, for rows [begin, end) of source.
+    template< typename Level >
+    void Accumulate(
+        const Level &source, const Level &target, const Transform &transform,
+        float max_distance_sq, float min_cos_angle, int begin, int end, Sums &sums )
+    {
+        const int width = source.depth.width();
+        const int target_width = target.depth.width();
+        const int target_height = target.depth.height();
+        const PinholeCamera &camera = target.depth.camera();
+
+        alignas( 16 ) float j[8];
+        j[7] = 0.0f;
+
+        RowSums row_sums;
+        for (int y = begin; y < end; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const size_t i = size_t( y )*width + x;
+                const float *normal = &source.normals[ 3*i ];
+                if (IsZero( normal )) continue;
+
+                float p[3];
+                Transform_apply( transform, &source.vertices[ 3*i ], p );
+                if (!(p[2] > 0.0f)) continue;
+
+                const float u = std::floor( camera.fx*p[0]/p[2] + camera.cx + 0.5f );
+                const float v = std::floor( camera.fy*p[1]/p[2] + camera.cy + 0.5f );
+                if (!(u >= 0.0f && u < float( target_width ) && v >= 0.0f && v < float( target_height ))) continue;
+
+                const size_t t = size_t( v )*target_width + size_t( u );
+                const float *target_normal = &target.normals[ 3*t ];
+                if (IsZero( target_normal )) continue;
+
+                const float *q = &target.vertices[ 3*t ];
+                const float d[3] = { p[0] - q[0], p[1] - q[1], p[2] - q[2] };
+                if (Dot( d, d ) > max_distance_sq) continue;
+
+                float rotated[3];
+                Rotate( transform, normal, rotated );
+                if (Dot( rotated, target_normal ) < min_cos_angle) continue;
+
+                    // d(n . (p + w x p + t - q)) / d(w, t) = (p x n, n)
+                const float *n = target_normal;
+                j[0] = p[1]*n[2] - p[2]*n[1];
+                j[1] = p[2]*n[0] - p[0]*n[2];
+                j[2] = p[0]*n[1] - p[1]*n[0];
+                j[3] = n[0];
+                j[4] = n[1];
+                j[5] = n[2];
+                j[6] = Dot( n, d );
+
+                row_sums.add( j );
+                ++sums.count;
+            }
+
+            row_sums.flush( sums.totals );
+        }
+    }
+
+} // namespace
+
+
+
+// class IcpRegistration:
+IcpRegistration::IcpRegistration( const TangoCameraIntrinsics *depth_intrinsics, const IcpParams &params )
+: intrinsics_( *depth_intrinsics ), params_( params )
+{
+    if (params_.iterations.empty()) throw std::invalid_argument( "IcpParams::iterations must not be empty" );
+
+    pool_.reset( new detail::WorkerPool( params_.threads ) );
+}
+
+
+IcpRegistration::~IcpRegistration()
+{
+}
+
+
+IcpResult IcpRegistration::align(
+    const TangoPointCloud *source, const TangoPointCloud *target, const Transform &guess )
+{
+    typedef std::chrono::steady_clock clock_type;
+    const clock_type::time_point start = clock_type::now();
+
+    buildPyramid( source, source_ );
+    buildPyramid( target, target_ );
+
+    IcpResult result;
+    result.transform = guess;
+    result.converged = false;
+    result.iterations = 0;
+    result.correspondences = 0;
+    result.rms_error = 0.0f;
+
+    const float max_distance_sq = params_.max_distance*params_.max_distance;
+    const float min_cos_angle = std::cos( params_.max_normal_angle );
+    const int levels = int( params_.iterations.size() );
+
+    std::vector< Sums > partials( pool_->size() );
+    for (int level = levels - 1; level >= 0; --level)
+    {
+        const Level &src = source_[level];
+        const Level &tgt = target_[level];
+        const int iterations = params_.iterations[ levels - 1 - level ];
+
+        bool converged = false;
+        for (int iteration = 0; iteration < iterations; ++iteration)
+        {
+            ++result.iterations;
+
+            for (Sums &sums: partials) std::memset( &sums, 0, sizeof sums );
+
+            const Transform transform = result.transform;
+            pool_->run( src.depth.height(),
+                [&]( int chunk, int begin, int end )
+                {
+                    Accumulate( src, tgt, transform, max_distance_sq, min_cos_angle, begin, end, partials[chunk] );
+                } );
+
+            Sums total = partials[0];
+            for (size_t p = 1; p < partials.size(); ++p)
+            {
+                total.count += partials[p].count;
+                for (int r = 0; r < sum_rows; ++r)
+                {
+                    for (int c = 0; c < 8; ++c) total.totals[r][c] += partials[p].totals[r][c];
+                }
+            }
+
+            double xi[6];
+            if (total.count < params_.min_correspondences || !Solve6( total.totals, xi )) break;
+
+            result.correspondences = total.count;
+            result.rms_error = float( std::sqrt( total.totals[6][6]/total.count ) );
+            result.transform = Transform_compose( TwistToTransform( xi ), result.transform );
+
+            const double rotation = std::sqrt( xi[0]*xi[0] + xi[1]*xi[1] + xi[2]*xi[2] );
+            const double translation = std::sqrt( xi[3]*xi[3] + xi[4]*xi[4] + xi[5]*xi[5] );
+            if (rotation < params_.rotation_epsilon && translation < params_.translation_epsilon)
+            {
+                converged = true;
+                break;
+            }
+        }
+
+        if (level == 0) result.converged = converged;
+    }
+
+    result.seconds = std::chrono::duration< double >( clock_type::now() - start ).count();
+    return result;
+}
+
+
+IcpResult IcpRegistration::align(
+    const TangoPointCloud *source, const TangoPointCloud *target, const TangoPoseData *guess )
+{
+    return align( source, target, Pose_toTransform( guess ) );
+}
+
+
+const IcpParams &IcpRegistration::params() const
+{
+    return params_;
+}
+
+
+void IcpRegistration::buildPyramid( const TangoPointCloud *cloud, std::vector< Level > &pyramid )
+{
+    pyramid.resize( params_.iterations.size() );
+    PointCloud_toDepthImage( cloud, &intrinsics_, pyramid[0].depth, params_.divisor );
+    for (size_t level = 1; level < pyramid.size(); ++level)
+    {
+        DepthImage_halve( pyramid[level - 1].depth, pyramid[level].depth );
+    }
+
+    for (Level &level: pyramid)
+    {
+        const int width = level.depth.width();
+        const int height = level.depth.height();
+        ComputeVertices( level.depth, *pool_, level.vertices );
+        ComputeNormals( width, height, *pool_, level.vertices, level.normals );
+    }
+}
+
+
+} // namespace boleo
@@ -0,0 +1,356 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Work-stealing task scheduler, with per-task deadlines.
+/*! @file
+
+    See task_scheduler.hpp, for details.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/task_scheduler.hpp"
+#include "boleo/detail/parallel.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined( __linux__ )
+#   include <sched.h>
+#   include <unistd.h>
+#endif
+
+
+    //! Namespace for Boleo.
+namespace boleo
+{
+
+
+namespace
+{
+
+        // Identifies the worker running on this thread, if any.
+    thread_local const TaskScheduler *current_scheduler = nullptr;
+    thread_local int current_worker = 0;
+
+
+        // Pins the calling thread to cpu.  Returns false on failure.
+    bool SetAffinity( int cpu )
+    {
+#if defined( __linux__ )
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+
+        cpu_set_t set;
+        CPU_ZERO( &set );
+        CPU_SET( cpu, &set );
+        return sched_setaffinity( 0, sizeof set, &set ) == 0;
+#else
+        (void) cpu;
+        return false;
+#endif
+    }
+
+} // namespace
+
+
+
+// class TaskStream:
+TaskStream::TaskStream()
+: generation_( 0 )
+{
+}
+
+
+
+// class TaskScheduler:
+TaskScheduler::TaskScheduler( const SchedulerParams &params )
+: next_worker_( 0 ),
+  queued_( 0 ),
+  outstanding_( 0 ),
+  stopping_( false ),
+  started_( 0 ),
+  affinity_failed_( false ),
+  submitted_( 0 ),
+  executed_( 0 ),
+  stolen_( 0 ),
+  superseded_( 0 ),
+  expired_( 0 ),
+  overran_( 0 )
+{
+    int threads = params.threads;
+    if (threads <= 0 && !params.cpus.empty()) threads = int( params.cpus.size() );
+    threads = detail::ThreadCount( threads );
+
+        // All workers must exist before any starts stealing.
+    for (int i = 0; i < threads; ++i) workers_.emplace_back( new Worker() );
+
+        // If a thread can't be created, those already running must be joined before workers_ is destroyed.
+    try
+    {
+        for (int i = 0; i < threads; ++i)
+        {
+            const int cpu = params.cpus.empty() ? -1 : params.cpus[ i % params.cpus.size() ];
+            workers_[i]->thread = std::thread( &TaskScheduler::run, this, i, cpu );
+        }
+    }
+    catch (...)
+    {
+        shutdown();
+        throw;
+    }
+
+    bool failed;
+    {
+        std::unique_lock< std::mutex > lock( idle_mutex_ );
+        all_done_.wait( lock, [this, threads] { return started_ == threads; } );
+        failed = affinity_failed_;
+    }
+
+    if (failed)
+    {
+        shutdown();
+        throw std::runtime_error( "Failed to set the CPU affinity of scheduler workers" );
+    }
+}
+
+
+TaskScheduler::~TaskScheduler()
+{
+    shutdown();
+}
+
+
+void TaskScheduler::submit( task_type task )
+{
+    submit( std::move( task ), clock_type::time_point::max() );
+}
+
+
+void TaskScheduler::submit( task_type task, clock_type::time_point deadline )
+{
+    Task entry = { std::move( task ), deadline, nullptr, 0 };
+    enqueue( std::move( entry ) );
+}
+
+
+void TaskScheduler::submit(
+    TaskStream &stream, task_type task, clock_type::time_point deadline )
+{
+    const uint64_t generation = stream.generation_.fetch_add( 1, std::memory_order_acq_rel ) + 1;
+
+    Task entry = { std::move( task ), deadline, &stream, generation };
+    enqueue( std::move( entry ) );
+}
+
+
+void TaskScheduler::wait()
+{
+    std::exception_ptr error;
+    {
+        std::unique_lock< std::mutex > lock( idle_mutex_ );
+        all_done_.wait( lock, [this] { return outstanding_.load() == 0; } );
+        std::swap( error, error_ );
+    }
+
+    if (error) std::rethrow_exception( error );
+}
+
+
+int TaskScheduler::threadCount() const
+{
+    return int( workers_.size() );
+}
+
+
+SchedulerStats TaskScheduler::stats() const
+{
+    SchedulerStats result;
+    result.submitted = submitted_.load( std::memory_order_relaxed );
+    result.executed = executed_.load( std::memory_order_relaxed );
+    result.stolen = stolen_.load( std::memory_order_relaxed );
+    result.superseded = superseded_.load( std::memory_order_relaxed );
+    result.expired = expired_.load( std::memory_order_relaxed );
+    result.overran = overran_.load( std::memory_order_relaxed );
+    return result;
+}
+
+
+void TaskScheduler::enqueue( Task task )
+{
+    submitted_.fetch_add( 1, std::memory_order_relaxed );
+    outstanding_.fetch_add( 1 );
+
+    const int index = current_scheduler == this
+        ? current_worker
+        : int( next_worker_.fetch_add( 1, std::memory_order_relaxed ) % workers_.size() );
+
+    {
+        Worker &worker = *workers_[index];
+        std::lock_guard< std::mutex > lock( worker.mutex );
+        worker.tasks.push_back( std::move( task ) );
+    }
+
+        // Incremented after the push, so a woken worker is sure to find it.
+    queued_.fetch_add( 1 );
+
+    std::lock_guard< std::mutex > lock( idle_mutex_ );
+    work_available_.notify_one();
+}
+
+
+void TaskScheduler::run( int index, int cpu )
+{
+    const bool pinned = cpu < 0 || SetAffinity( cpu );
+    {
+        std::lock_guard< std::mutex > lock( idle_mutex_ );
+        ++started_;
+        if (!pinned) affinity_failed_ = true;
+    }
+    all_done_.notify_all();
+
+    current_scheduler = this;
+    current_worker = index;
+
+    Task task;
+    for (;;)
+    {
+        if (take( index, task ))
+        {
+            execute( task );
+            continue;
+        }
+
+        std::unique_lock< std::mutex > lock( idle_mutex_ );
+        work_available_.wait( lock, [this] { return stopping_ || queued_.load() > 0; } );
+        if (stopping_) return;
+    }
+}
+
+
+bool TaskScheduler::take( int index, Task &task )
+{
+    {
+        Worker &own = *workers_[index];
+        std::lock_guard< std::mutex > lock( own.mutex );
+        if (!own.tasks.empty())
+        {
+                // Newest first, as its data is most likely still cached.
+            task = std::move( own.tasks.back() );
+            own.tasks.pop_back();
+            queued_.fetch_sub( 1 );
+            return true;
+        }
+    }
+
+    const int count = int( workers_.size() );
+    for (int i = 1; i < count; ++i)
+    {
+        Worker &victim = *workers_[ (index + i) % count ];
+        std::lock_guard< std::mutex > lock( victim.mutex );
+        if (!victim.tasks.empty())
+        {
+            task = std::move( victim.tasks.front() );
+            victim.tasks.pop_front();
+            queued_.fetch_sub( 1 );
+            stolen_.fetch_add( 1, std::memory_order_relaxed );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void TaskScheduler::execute( Task &task )
+{
+    if (task.stream
+        && task.stream->generation_.load( std::memory_order_acquire ) != task.generation)
+    {
+        superseded_.fetch_add( 1, std::memory_order_relaxed );
+    }
+    else if (clock_type::now() > task.deadline)
+    {
+        expired_.fetch_add( 1, std::memory_order_relaxed );
+    }
+    else
+    {
+        try
+        {
+            task.function();
+        }
+        catch (...)
+        {
+            std::lock_guard< std::mutex > lock( idle_mutex_ );
+            if (!error_) error_ = std::current_exception();
+        }
+
+        executed_.fetch_add( 1, std::memory_order_relaxed );
+        if (clock_type::now() > task.deadline) overran_.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+        // Release whatever the task captured, before wait() can return.
+    task.function = nullptr;
+
+    if (outstanding_.fetch_sub( 1 ) == 1)
+    {
+        std::lock_guard< std::mutex > lock( idle_mutex_ );
+        all_done_.notify_all();
+    }
+}
+
+
+void TaskScheduler::shutdown()
+{
+    {
+        std::lock_guard< std::mutex > lock( idle_mutex_ );
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+
+    for (std::unique_ptr< Worker > &worker: workers_)
+    {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+
+
+std::vector< int > FastestCpus()
+{
+    std::vector< int > result;
+
+#if defined( __linux__ )
+    long fastest = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string( cpu );
+        if (access( dir.c_str(), F_OK ) != 0) break;
+
+        std::ifstream file( dir + "/cpufreq/cpuinfo_max_freq" );
+        long frequency = 0;
+        if (!(file >> frequency) || frequency < fastest) continue;
+
+        if (frequency > fastest)
+        {
+            fastest = frequency;
+            result.clear();
+        }
+
+        result.push_back( cpu );
+    }
+#endif
+
+    return result;
+}
+
+
+} // namespace boleo
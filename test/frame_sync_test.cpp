@@ -0,0 +1,350 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright Matthew A. Gruenke 2017.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  (See accompanying file LICENSE_1_0.txt or copy at
+//   http://www.boost.org/LICENSE_1_0.txt)
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//! Tests of FrameSynchronizer, with synthetic frames.
+/*! @file
+
+    Frames are published to a TangoFrameHub directly, so neither a device
+    nor the emulator is needed.  Streams run at 5 Hz (clouds), 30 Hz (images)
+    & 100 Hz (poses), with timestamp jitter and some images missing.  Some
+    tests also stall streams, or stop them early.
+*/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "boleo/frame_sync.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+    //! Counts & reports a failed check, without stopping the test.
+#define CHECK( condition ) \
+    ((condition) ? (void) 0 : (void) (++failures, std::printf( "%s:%d: CHECK( %s ) failed\n", \
+        __FILE__, __LINE__, #condition )))
+
+
+namespace
+{
+
+    using namespace boleo;
+
+
+    int failures = 0;
+
+
+        // Storage for synthetic frames.
+    float cloud_points[16][4] = {};
+    uint8_t image_pixels[ 64*48*3/2 ] = {};
+
+
+    void PublishCloud( TangoFrameHub &hub, double timestamp )
+    {
+        TangoPointCloud cloud = {};
+        cloud.timestamp = timestamp;
+        cloud.num_points = 16;
+        cloud.points = cloud_points;
+        hub.onPointCloudAvailable( &cloud );
+    }
+
+
+    void PublishImage( TangoFrameHub &hub, double timestamp )
+    {
+        TangoImageBuffer image = {};
+        image.width = 64;
+        image.height = 48;
+        image.stride = 64;
+        image.timestamp = timestamp;
+        image.format = TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP;
+        image.data = image_pixels;
+        hub.onFrameAvailable( TANGO_CAMERA_COLOR, &image );
+    }
+
+
+    void PublishPose( TangoFrameHub &hub, double timestamp )
+    {
+        TangoPoseData pose = {};
+        pose.timestamp = timestamp;
+        pose.frame.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
+        pose.frame.target = TANGO_COORDINATE_FRAME_DEVICE;
+        pose.status_code = TANGO_POSE_VALID;
+        pose.orientation[3] = 1.0;
+        hub.onPoseAvailable( &pose );
+    }
+
+
+        // A frame to publish.
+    struct Event
+    {
+        enum Kind { cloud, image, pose };
+
+        double timestamp;
+        Kind kind;
+    };
+
+
+        // Builds 10 s of interleaved streams, in order of timestamp.
+    std::vector< Event > MakeEvents( uint32_t seed )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_real_distribution< double > jitter( -0.003, 0.003 );
+
+        std::vector< Event > result;
+        for (int i = 0; i < 50; ++i) result.push_back( { 0.2*i + 0.001, Event::cloud } );
+        for (int i = 0; i < 300; ++i)
+        {
+                // Every 17th image is missing, leaving some clouds without a partner.
+            if (i % 17 != 0) result.push_back( { i/30.0 + jitter( rng ), Event::image } );
+        }
+        for (int i = 0; i < 1000; ++i) result.push_back( { i/100.0 + jitter( rng ), Event::pose } );
+
+        std::stable_sort( result.begin(), result.end(),
+            []( const Event &a, const Event &b ) { return a.timestamp < b.timestamp; } );
+
+        return result;
+    }
+
+
+        // Removes the frames of kind with timestamps in [begin, end).
+    void Remove( std::vector< Event > &events, Event::Kind kind, double begin, double end )
+    {
+        events.erase(
+            std::remove_if( events.begin(), events.end(),
+                [&]( const Event &event )
+                {
+                    return event.kind == kind && event.timestamp >= begin && event.timestamp < end;
+                } ),
+            events.end() );
+    }
+
+
+    void Publish( TangoFrameHub &hub, const Event &event )
+    {
+        switch (event.kind)
+        {
+            case Event::cloud:  PublishCloud( hub, event.timestamp ); break;
+            case Event::image:  PublishImage( hub, event.timestamp ); break;
+            case Event::pose:   PublishPose( hub, event.timestamp ); break;
+        }
+    }
+
+
+        // Timestamp of the frame of kind nearest t, among events.
+    double Nearest( const std::vector< Event > &events, Event::Kind kind, double t )
+    {
+        double result = -1.0e9;
+        for (const Event &event: events)
+        {
+            if (event.kind == kind && std::fabs( event.timestamp - t ) < std::fabs( result - t ))
+            {
+                result = event.timestamp;
+            }
+        }
+
+        return result;
+    }
+
+
+        // Publishes events in order, popping as it goes, and compares each tuple with a brute-force match.
+    SyncStats CheckMatching( const std::vector< Event > &events )
+    {
+        TangoFrameHub hub;
+        SyncParams params;
+        params.tolerance = 0.01;
+        FrameSynchronizer sync( hub, params );
+
+        int clouds = 0;
+        int expected_matched = 0;
+        for (const Event &event: events)
+        {
+            if (event.kind != Event::cloud) continue;
+
+            ++clouds;
+            const double t = event.timestamp;
+            if (std::fabs( Nearest( events, Event::image, t ) - t ) <= params.tolerance
+                && std::fabs( Nearest( events, Event::pose, t ) - t ) <= params.tolerance)
+            {
+                ++expected_matched;
+            }
+        }
+
+        int matched = 0;
+        double last = -1.0;
+        SyncedFrames frames;
+        for (const Event &event: events)
+        {
+            Publish( hub, event );
+            while (sync.tryPop( frames ))
+            {
+                const double t = frames.cloud->timestamp();
+                CHECK( t > last );
+                CHECK( frames.image->timestamp() == Nearest( events, Event::image, t ) );
+                CHECK( frames.pose->timestamp() == Nearest( events, Event::pose, t ) );
+                last = t;
+                ++matched;
+            }
+        }
+
+        const SyncStats stats = sync.stats();
+        CHECK( matched == expected_matched );
+        CHECK( stats.matched == matched );
+        CHECK( stats.unmatched == clouds - expected_matched );
+        CHECK( stats.dropped_clouds == 0 );
+        CHECK( stats.dropped_images == 0 );
+        CHECK( stats.dropped_poses == 0 );
+        return stats;
+    }
+
+
+    void TestMatching()
+    {
+        const SyncStats stats = CheckMatching( MakeEvents( 1 ) );
+        CHECK( stats.unmatched > 0 );
+    }
+
+
+        // Stalls the poses for 2 s, then stops the clouds 2 s before the rest.  Clouds during the stall are
+        //  unmatched once the next arrives, rather than waiting until they overflow, and the images & poses
+        //  running on after the last cloud aren't dropped.
+    void TestStalled()
+    {
+        std::vector< Event > events = MakeEvents( 3 );
+        Remove( events, Event::pose, 3.0, 5.0 );
+        Remove( events, Event::cloud, 8.0, 10.0 );
+
+        const SyncStats stats = CheckMatching( events );
+        CHECK( stats.unmatched >= 10 );
+    }
+
+
+        // Overflows the subscription queues & the synchronizer's own queues.
+    void TestDrops()
+    {
+        TangoFrameHub hub;
+        SyncParams params;
+        params.tolerance = 0.01;
+        params.poses = false;
+        params.cloud_capacity = 4;
+        params.image_capacity = 8;
+        FrameSynchronizer sync( hub, params );
+
+            // The subscription keeps the last 4 of 10 clouds.
+        for (int i = 0; i < 10; ++i) PublishCloud( hub, 0.1*i );
+        CHECK( sync.stats().dropped_clouds == 6 );
+
+            // With no images, each of those 4 waits only until a later cloud arrives, so 3 are unmatched.
+        SyncedFrames frames;
+        CHECK( !sync.tryPop( frames ) );
+        CHECK( sync.stats().unmatched == 3 );
+
+            // 4 more overflow the synchronizer's queue, dropping the cloud at 0.9, & all but the last are unmatched.
+        for (int i = 10; i < 14; ++i) PublishCloud( hub, 0.1*i );
+        CHECK( !sync.tryPop( frames ) );
+        CHECK( sync.stats().dropped_clouds == 7 );
+        CHECK( sync.stats().unmatched == 6 );
+
+            // Only the last 8 images (1.05 - 1.4) survive the subscription, & the cloud at 1.3 matches.
+        for (int i = 0; i <= 28; ++i) PublishImage( hub, 0.05*i );
+        CHECK( sync.stats().dropped_images == 21 );
+
+        int matched = 0;
+        while (sync.tryPop( frames ))
+        {
+            CHECK( frames.image );
+            CHECK( !frames.pose );
+            ++matched;
+        }
+
+            // With no cloud waiting, images beyond the synchronizer's capacity aren't dropped.
+        for (int i = 29; i < 49; ++i)
+        {
+            PublishImage( hub, 0.05*i );
+            CHECK( !sync.tryPop( frames ) );
+        }
+
+        const SyncStats stats = sync.stats();
+        CHECK( matched == 1 );
+        CHECK( stats.matched == 1 );
+        CHECK( stats.unmatched == 6 );
+        CHECK( stats.dropped_clouds == 7 );
+        CHECK( stats.dropped_images == 21 );
+        CHECK( stats.dropped_poses == 0 );
+    }
+
+
+        // Publishes from another thread, at roughly real-time rates, while polling.
+    void TestConcurrent()
+    {
+        const std::vector< Event > events = MakeEvents( 2 );
+
+        TangoFrameHub hub;
+        SyncParams params;
+        params.tolerance = 0.01;
+        FrameSynchronizer sync( hub, params );
+
+        std::thread producer( [&]
+            {
+                for (const Event &event: events)
+                {
+                    Publish( hub, event );
+                    std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+                }
+            } );
+
+        int matched = 0;
+        double last = -1.0;
+        SyncedFrames frames;
+        auto check = [&]
+            {
+                const double t = frames.cloud->timestamp();
+                CHECK( t > last );
+                CHECK( std::fabs( frames.image->timestamp() - t ) <= params.tolerance );
+                CHECK( std::fabs( frames.pose->timestamp() - t ) <= params.tolerance );
+                last = t;
+                ++matched;
+            };
+
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+        while (std::chrono::steady_clock::now() < end)
+        {
+            while (sync.tryPop( frames )) check();
+            if (sync.stats().matched + sync.stats().unmatched == 50) break;
+
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+
+        producer.join();
+        while (sync.tryPop( frames )) check();
+
+            // Every cloud is accounted for.
+        const SyncStats stats = sync.stats();
+        CHECK( stats.matched == matched );
+        CHECK( stats.matched + stats.unmatched + stats.dropped_clouds == 50 );
+        CHECK( stats.matched > 0 );
+    }
+
+}
+
+
+int main()
+{
+    TestMatching();
+    TestStalled();
+    TestDrops();
+    TestConcurrent();
+
+    if (failures) std::printf( "%d check(s) failed\n", failures );
+    return failures ? 1 : 0;
+}